@@ -0,0 +1,190 @@
+#include "CSVReader.h"
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+
+// Chunks smaller than this are not worth a task of their own
+static const size_t kMinChunkBytes = size_t(1) << 20;
+
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool CSVReader::parseNumber(const char *begin, const char *end, double &value)
+{
+    while (begin < end && isBlank(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isBlank(end[-1])) {
+        --end;
+    }
+    if (begin < end && *begin == '+') {
+        ++begin;
+    }
+    if (begin == end) {
+        return false;
+    }
+    
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    // strtod needs a terminated string and the mapping has none
+    char buffer[64];
+    size_t length = static_cast<size_t>(end - begin);
+    if (length >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char *parsed = nullptr;
+    value = std::strtod(buffer, &parsed);
+    return parsed == buffer + length;
+#endif
+}
+
+// Calls field(index, value) for every numeric field of the line and
+// returns how many there were
+template <typename FieldFunction>
+static size_t parseLine(const char *begin, const char *end, char delimiter, FieldFunction field)
+{
+    size_t count = 0;
+    while (true) {
+        const char *fieldEnd = static_cast<const char *>(std::memchr(begin, delimiter, end - begin));
+        if (!fieldEnd) {
+            fieldEnd = end;
+        }
+        
+        double value;
+        if (CSVReader::parseNumber(begin, fieldEnd, value)) {
+            field(count, value);
+            ++count;
+        }
+        
+        if (fieldEnd == end) {
+            break;
+        }
+        begin = fieldEnd + 1;
+    }
+    return count;
+}
+
+static const char *lineEnd(const char *begin, const char *end)
+{
+    const char *newline = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+    return newline ? newline : end;
+}
+
+CSVReader::Data CSVReader::read(const std::string &path, ThreadPool &pool)
+{
+    MappedFile file(path);
+    file.adviseSequential();
+    const char *data = file.data();
+    const char *dataEnd = data + file.size();
+    
+    // The first line holding a number fixes the delimiter and column count
+    char delimiter = ';';
+    size_t columns = 0;
+    for (const char *line = data; line < dataEnd && columns == 0;) {
+        const char *end = lineEnd(line, dataEnd);
+        delimiter = std::memchr(line, ';', end - line) ? ';' : ',';
+        columns = parseLine(line, end, delimiter, [](size_t, double) {});
+        line = end + 1;
+    }
+    if (columns == 0) {
+        throw std::runtime_error("File has no valid data columns");
+    }
+    
+    // Newline-aligned chunks, a few per worker to balance uneven lines
+    std::vector<const char *> bounds(1, data);
+    const size_t chunkCount = std::max<size_t>(1, std::min(pool.threadCount() * 4,
+                                                           file.size() / kMinChunkBytes));
+    for (size_t c = 1; c < chunkCount; ++c) {
+        const char *cut = data + file.size() * c / chunkCount;
+        cut = std::max(cut, bounds.back());
+        cut = std::min(lineEnd(cut, dataEnd) + 1, dataEnd);
+        bounds.push_back(cut);
+    }
+    bounds.push_back(dataEnd);
+    
+    // Every line is given a slot up front, so each chunk knows where its
+    // rows go before parsing; lines that turn out to be invalid leave
+    // holes that are squeezed out afterwards
+    std::vector<size_t> slotStart(chunkCount + 1, 0);
+    pool.parallelFor(chunkCount, [&](size_t c, size_t) {
+        size_t lines = 0;
+        for (const char *line = bounds[c]; line < bounds[c + 1]; line = lineEnd(line, bounds[c + 1]) + 1) {
+            ++lines;
+        }
+        slotStart[c + 1] = lines;
+    });
+    for (size_t c = 0; c < chunkCount; ++c) {
+        slotStart[c + 1] += slotStart[c];
+    }
+    
+    const size_t slots = slotStart[chunkCount];
+    const bool hasTime = columns >= 2;
+    std::vector<std::vector<double>> buffers(columns);
+    for (auto &buffer : buffers) {
+        buffer.resize(slots);
+    }
+    
+    std::vector<size_t> rowsParsed(chunkCount, 0);
+    pool.parallelFor(chunkCount, [&](size_t c, size_t) {
+        size_t row = slotStart[c];
+        for (const char *line = bounds[c]; line < bounds[c + 1];) {
+            const char *end = lineEnd(line, bounds[c + 1]);
+            size_t count = parseLine(line, end, delimiter, [&](size_t index, double value) {
+                if (index < columns) {
+                    buffers[index][row] = value;
+                }
+            });
+            
+            // Single-column files keep the first number of every line;
+            // otherwise a row must match the column count exactly
+            if (hasTime ? count == columns : count > 0) {
+                ++row;
+            }
+            line = end + 1;
+        }
+        rowsParsed[c] = row - slotStart[c];
+    });
+    
+    // Close the holes left by skipped lines; rows only move towards the front
+    size_t rows = 0;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        if (rows != slotStart[c]) {
+            for (auto &buffer : buffers) {
+                std::copy(buffer.begin() + slotStart[c], buffer.begin() + slotStart[c] + rowsParsed[c],
+                          buffer.begin() + rows);
+            }
+        }
+        rows += rowsParsed[c];
+    }
+    
+    Data result;
+    for (auto &buffer : buffers) {
+        buffer.resize(rows);
+    }
+    if (hasTime) {
+        result.time = std::move(buffers[0]);
+        result.channels.assign(std::make_move_iterator(buffers.begin() + 1),
+                               std::make_move_iterator(buffers.end()));
+    } else {
+        result.channels = std::move(buffers);
+    }
+    return result;
+}
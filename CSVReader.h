@@ -0,0 +1,41 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+
+// Parallel loader for numeric CSV exports. The file is memory-mapped,
+// cut into newline-aligned chunks and parsed by the pool straight into
+// column-major buffers, so no per-line strings or row matrix are built.
+//
+// Rules (as in the original line-by-line loader):
+//  - fields are separated by ';', or by ',' when the first data line has no ';'
+//  - fields that are not numbers are ignored, and lines without any number
+//    (headers, comments) are skipped
+//  - the first data line fixes the column count; with two or more columns
+//    the first is time and rows with a different count are dropped
+class CSVReader
+{
+public:
+    struct Data {
+        // Empty for single-column files: the caller generates the time axis
+        std::vector<double> time;
+        std::vector<std::vector<double>> channels;
+        
+        size_t samples() const { return channels.empty() ? 0 : channels[0].size(); }
+    };
+    
+    // Throws std::runtime_error if the file cannot be read or has no data
+    static Data read(const std::string &path, ThreadPool &pool);
+    
+    // Parses the whole of [begin, end) as one number, surrounding blanks and
+    // a leading '+' allowed. Returns false for anything else, e.g. a header
+    // word. The text need not be terminated.
+    static bool parseNumber(const char *begin, const char *end, double &value);
+};
+
+#endif
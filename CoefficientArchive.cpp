@@ -0,0 +1,616 @@
+#include "CoefficientArchive.h"
+
+#include "MappedFile.h"
+#include "PerfRecorder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+
+static const char kMagic[8] = {'M', 'D', 'S', 'V', '2', 'C', 'W', 'Z'};
+static const uint32_t kVersion = 1;
+static const uint32_t kCodecRaw = 0;
+static const uint32_t kCodecShuffleRle = 1;
+
+// Run-length control bytes: below 0x80 a literal of control + 1 bytes
+// follows, otherwise one byte repeated (control & 0x7f) + kMinRun times
+static const size_t kMinRun = 3;
+static const size_t kMaxRun = 0x7f + kMinRun;
+static const size_t kMaxLiteral = 0x80;
+
+struct CoefficientArchiveHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint64_t rows;
+    uint64_t columns;
+    double samplingRate;
+    double timeOrigin;
+    uint32_t chunkRows;
+    uint32_t chunkColumns;
+    uint64_t indexOffset;
+};
+
+static_assert(sizeof(CoefficientArchiveHeader) == 64, "CoefficientArchiveHeader must match the on-disk layout");
+
+static size_t ceilDivide(size_t value, size_t divisor)
+{
+    return value / divisor + (value % divisor != 0);
+}
+
+// Stored values [first, end) of a row with step that fall into block
+static void storedRange(size_t columns, size_t step, size_t block, size_t chunkColumns, size_t &first, size_t &end)
+{
+    first = ceilDivide(block * chunkColumns, step);
+    end = ceilDivide(std::min((block + 1) * chunkColumns, columns), step);
+}
+
+// Bytes of the chunk of band and block before compression
+static size_t chunkBytes(const std::vector<size_t> &rowSteps, size_t columns, size_t chunkRows, size_t chunkColumns,
+                         size_t elementSize, size_t band, size_t block)
+{
+    size_t total = 0;
+    const size_t lastRow = std::min((band + 1) * chunkRows, rowSteps.size());
+    for (size_t row = band * chunkRows; row < lastRow; ++row) {
+        size_t first = 0;
+        size_t end = 0;
+        storedRange(columns, rowSteps[row], block, chunkColumns, first, end);
+        total += (end - first) * elementSize;
+    }
+    return total;
+}
+
+// Complex values are two words; each component is XORed with its own
+// predecessor, whose sign and exponent it usually shares
+static size_t wordSize(CoefficientMatrix::Format format)
+{
+    return format == CoefficientMatrix::ComplexDouble ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+static size_t componentCount(CoefficientMatrix::Format format)
+{
+    return format == CoefficientMatrix::ComplexDouble || format == CoefficientMatrix::ComplexFloat ? 2 : 1;
+}
+
+// Byte p of the XOR delta of word j goes to planes[p * words + j]. Bytes
+// are taken by significance, so archives read the same on any host.
+template <typename Word>
+static void deltaShuffle(const unsigned char *values, size_t words, size_t components, unsigned char *planes)
+{
+    Word previous[2] = {0, 0};
+    for (size_t j = 0; j < words; ++j) {
+        Word value;
+        std::memcpy(&value, values + j * sizeof(Word), sizeof(Word));
+        // components is 1 or 2
+        const Word delta = value ^ previous[j & (components - 1)];
+        previous[j & (components - 1)] = value;
+        for (size_t p = 0; p < sizeof(Word); ++p) {
+            planes[p * words + j] = static_cast<unsigned char>(delta >> (8 * p));
+        }
+    }
+}
+
+template <typename Word>
+static void unshuffleDelta(const unsigned char *planes, size_t words, size_t components, unsigned char *values)
+{
+    Word previous[2] = {0, 0};
+    for (size_t j = 0; j < words; ++j) {
+        Word delta = 0;
+        for (size_t p = 0; p < sizeof(Word); ++p) {
+            delta |= static_cast<Word>(planes[p * words + j]) << (8 * p);
+        }
+        const Word value = delta ^ previous[j & (components - 1)];
+        previous[j & (components - 1)] = value;
+        std::memcpy(values + j * sizeof(Word), &value, sizeof(Word));
+    }
+}
+
+static void appendLiterals(const unsigned char *data, size_t count, std::vector<unsigned char> &out)
+{
+    while (count > 0) {
+        const size_t length = std::min(count, kMaxLiteral);
+        out.push_back(static_cast<unsigned char>(length - 1));
+        out.insert(out.end(), data, data + length);
+        data += length;
+        count -= length;
+    }
+}
+
+static void runLengthEncode(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+{
+    out.clear();
+    out.reserve(size + size / kMaxLiteral + 1);
+    size_t literalStart = 0;
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < kMaxRun && data[i + run] == data[i]) {
+            ++run;
+        }
+        if (run >= kMinRun) {
+            appendLiterals(data + literalStart, i - literalStart, out);
+            out.push_back(static_cast<unsigned char>(0x80 | (run - kMinRun)));
+            out.push_back(data[i]);
+            literalStart = i + run;
+        }
+        i += run;
+    }
+    appendLiterals(data + literalStart, size - literalStart, out);
+}
+
+// False unless the input decodes to exactly size bytes
+static bool runLengthDecode(const unsigned char *in, size_t inSize, unsigned char *out, size_t size)
+{
+    size_t i = 0;
+    size_t o = 0;
+    while (i < inSize) {
+        const unsigned char control = in[i++];
+        if (control < 0x80) {
+            const size_t length = control + 1u;
+            if (length > inSize - i || length > size - o) {
+                return false;
+            }
+            std::memcpy(out + o, in + i, length);
+            i += length;
+            o += length;
+        } else {
+            const size_t length = (control & 0x7fu) + kMinRun;
+            if (i >= inSize || length > size - o) {
+                return false;
+            }
+            std::memset(out + o, in[i++], length);
+            o += length;
+        }
+    }
+    return o == size;
+}
+
+// Compresses size bytes of values into payload; returns the codec used
+static uint32_t encodeChunk(CoefficientMatrix::Format format, const unsigned char *values, size_t size,
+                            std::vector<unsigned char> &planes, std::vector<unsigned char> &payload)
+{
+    if (size != 0) {
+        const size_t words = size / wordSize(format);
+        planes.resize(size);
+        if (wordSize(format) == sizeof(uint64_t)) {
+            deltaShuffle<uint64_t>(values, words, componentCount(format), planes.data());
+        } else {
+            deltaShuffle<uint32_t>(values, words, componentCount(format), planes.data());
+        }
+        runLengthEncode(planes.data(), size, payload);
+        if (payload.size() < size) {
+            return kCodecShuffleRle;
+        }
+    }
+    payload.assign(values, values + size);
+    return kCodecRaw;
+}
+
+static void decodeChunk(CoefficientMatrix::Format format, uint32_t codec, const unsigned char *payload,
+                        size_t payloadSize, size_t size, std::vector<unsigned char> &planes, unsigned char *values)
+{
+    if (codec == kCodecRaw) {
+        std::memcpy(values, payload, size);
+        return;
+    }
+    planes.resize(size);
+    if (!runLengthDecode(payload, payloadSize, planes.data(), size)) {
+        throw std::runtime_error("CWT archive chunk is corrupt");
+    }
+    const size_t words = size / wordSize(format);
+    if (wordSize(format) == sizeof(uint64_t)) {
+        unshuffleDelta<uint64_t>(planes.data(), words, componentCount(format), values);
+    } else {
+        unshuffleDelta<uint32_t>(planes.data(), words, componentCount(format), values);
+    }
+}
+
+
+// Appends chunks in index order and writes the index and the header last
+class CoefficientArchive::Writer
+{
+public:
+    Writer(const std::string &path, CoefficientMatrix::Format format, const std::vector<double> &scales,
+           const std::vector<size_t> &rowSteps, size_t columns, double samplingRate, double timeOrigin)
+        : m_path(path)
+        , m_chunkCount(ceilDivide(scales.size(), kChunkRows) * ceilDivide(columns, kChunkColumns))
+    {
+        std::memset(&m_header, 0, sizeof(m_header));
+        std::memcpy(m_header.magic, kMagic, sizeof(kMagic));
+        m_header.version = kVersion;
+        m_header.format = format;
+        m_header.rows = scales.size();
+        m_header.columns = columns;
+        m_header.samplingRate = samplingRate;
+        m_header.timeOrigin = timeOrigin;
+        m_header.chunkRows = kChunkRows;
+        m_header.chunkColumns = kChunkColumns;
+        
+        m_out.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_out) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        // The header is rewritten with the index offset by finish()
+        m_out.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+        m_out.write(reinterpret_cast<const char *>(scales.data()), scales.size() * sizeof(double));
+        for (size_t step : rowSteps) {
+            const uint64_t value = step;
+            m_out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+        if (!m_out) {
+            throw std::runtime_error("Failed to write " + path);
+        }
+        m_offset = sizeof(m_header) + scales.size() * (sizeof(double) + sizeof(uint64_t));
+        m_index.reserve(m_chunkCount);
+    }
+    
+    CoefficientMatrix::Format format() const { return static_cast<CoefficientMatrix::Format>(m_header.format); }
+    size_t chunkCount() const { return m_chunkCount; }
+    
+    void append(const std::vector<unsigned char> &payload, uint32_t codec)
+    {
+        m_out.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+        if (!m_out) {
+            throw std::runtime_error("Failed to write " + m_path);
+        }
+        m_index.push_back({m_offset, static_cast<uint32_t>(payload.size()), codec});
+        m_offset += payload.size();
+    }
+    
+    void finish()
+    {
+        if (m_index.size() != m_chunkCount) {
+            throw std::runtime_error("The transform ended before " + m_path + " was complete");
+        }
+        m_out.write(reinterpret_cast<const char *>(m_index.data()), m_index.size() * sizeof(Chunk));
+        m_header.indexOffset = m_offset;
+        m_out.seekp(0);
+        m_out.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+        m_out.close();
+        if (!m_out) {
+            throw std::runtime_error("Failed to write " + m_path);
+        }
+    }
+
+private:
+    static_assert(sizeof(Chunk) == 16, "Chunk must match the on-disk index entry");
+    
+    std::string m_path;
+    std::ofstream m_out;
+    CoefficientArchiveHeader m_header;
+    size_t m_chunkCount;
+    uint64_t m_offset;
+    std::vector<Chunk> m_index;
+};
+
+
+bool CoefficientArchive::isArchive(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void CoefficientArchive::write(const std::string &path, const CoefficientMatrix &coefficients,
+                               const std::vector<double> &scales, double samplingRate, double timeOrigin,
+                               ThreadPool *pool)
+{
+    if (scales.size() != coefficients.rows()) {
+        throw std::invalid_argument("One scale per coefficient row is required");
+    }
+    PerfRecorder::Scope scope("archive write");
+    
+    std::vector<size_t> rowSteps(coefficients.rows());
+    for (size_t row = 0; row < rowSteps.size(); ++row) {
+        rowSteps[row] = coefficients.rowStep(row);
+    }
+    const CoefficientMatrix::Format format = coefficients.format();
+    const size_t elementSize = CoefficientMatrix::elementSize(format);
+    const size_t columns = coefficients.columns();
+    const size_t bands = ceilDivide(coefficients.rows(), kChunkRows);
+    Writer writer(path, format, scales, rowSteps, columns, samplingRate, timeOrigin);
+    
+    // Chunks are compressed a batch at a time and written in order, so at
+    // most a few compressed chunks per worker are held
+    const size_t workers = pool ? pool->threadCount() : 1;
+    const size_t batchSize = 4 * workers;
+    std::vector<std::vector<unsigned char>> payloads(batchSize);
+    std::vector<uint32_t> codecs(batchSize);
+    std::vector<std::vector<unsigned char>> values(workers);
+    std::vector<std::vector<unsigned char>> planes(workers);
+    
+    for (size_t batch = 0; batch < writer.chunkCount(); batch += batchSize) {
+        const size_t count = std::min(batchSize, writer.chunkCount() - batch);
+        auto encode = [&](size_t index, size_t worker) {
+            const size_t block = (batch + index) / bands;
+            const size_t band = (batch + index) % bands;
+            std::vector<unsigned char> &chunk = values[worker];
+            chunk.resize(chunkBytes(rowSteps, columns, kChunkRows, kChunkColumns, elementSize, band, block));
+            
+            unsigned char *out = chunk.data();
+            const size_t lastRow = std::min((band + 1) * kChunkRows, coefficients.rows());
+            for (size_t row = band * kChunkRows; row < lastRow; ++row) {
+                size_t first = 0;
+                size_t end = 0;
+                storedRange(columns, rowSteps[row], block, kChunkColumns, first, end);
+                std::memcpy(out, static_cast<const unsigned char *>(coefficients.rowData(row)) + first * elementSize,
+                            (end - first) * elementSize);
+                out += (end - first) * elementSize;
+            }
+            codecs[index] = encodeChunk(format, chunk.data(), chunk.size(), planes[worker], payloads[index]);
+        };
+        if (pool) {
+            pool->parallelFor(count, encode);
+        } else {
+            for (size_t index = 0; index < count; ++index) {
+                encode(index, 0);
+            }
+        }
+        for (size_t index = 0; index < count; ++index) {
+            writer.append(payloads[index], codecs[index]);
+        }
+    }
+    writer.finish();
+    scope.setItems(static_cast<double>(coefficients.rows()) * columns);
+}
+
+CoefficientArchive::CoefficientArchive(const std::string &path)
+    : m_file(std::make_shared<MappedFile>(path))
+{
+    CoefficientArchiveHeader header;
+    if (m_file->size() < sizeof(header)) {
+        throw std::runtime_error("File is too short for a CWT archive header");
+    }
+    std::memcpy(&header, m_file->data(), sizeof(header));
+    
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a CWT archive");
+    }
+    if (header.version != kVersion) {
+        throw std::runtime_error("Unsupported CWT archive version");
+    }
+    if (header.format > CoefficientMatrix::PowerFloat) {
+        throw std::runtime_error("Unknown element format in CWT archive");
+    }
+    
+    // As for signal files, no corrupt field may overflow the arithmetic:
+    // the scale table and the index must fit between header and end
+    const uint64_t fileSize = m_file->size();
+    const uint64_t tableEntry = sizeof(double) + sizeof(uint64_t);
+    bool layoutValid = header.chunkRows > 0 && header.chunkColumns > 0 &&
+                       header.rows <= (fileSize - sizeof(header)) / tableEntry;
+    uint64_t chunkCount = 0;
+    if (layoutValid) {
+        const uint64_t bands = ceilDivide(header.rows, header.chunkRows);
+        const uint64_t blocks = ceilDivide(header.columns, header.chunkColumns);
+        const uint64_t dataOffset = sizeof(header) + header.rows * tableEntry;
+        layoutValid = header.indexOffset >= dataOffset && header.indexOffset <= fileSize &&
+                      (bands == 0 || blocks <= (fileSize - header.indexOffset) / sizeof(Chunk) / bands);
+        if (layoutValid) {
+            chunkCount = bands * blocks;
+            layoutValid = fileSize - header.indexOffset == chunkCount * sizeof(Chunk);
+        }
+    }
+    if (!layoutValid) {
+        throw std::runtime_error("CWT archive is truncated or corrupt");
+    }
+    
+    m_format = static_cast<CoefficientMatrix::Format>(header.format);
+    m_columns = static_cast<size_t>(header.columns);
+    m_samplingRate = header.samplingRate;
+    m_timeOrigin = header.timeOrigin;
+    m_chunkRows = header.chunkRows;
+    m_chunkColumns = header.chunkColumns;
+    if (!(m_samplingRate > 0.0)) {
+        throw std::runtime_error("CWT archive has no valid sampling rate");
+    }
+    
+    const char *table = m_file->data() + sizeof(header);
+    m_scales.resize(static_cast<size_t>(header.rows));
+    std::memcpy(m_scales.data(), table, m_scales.size() * sizeof(double));
+    table += m_scales.size() * sizeof(double);
+    m_rowSteps.resize(m_scales.size());
+    for (size_t row = 0; row < m_rowSteps.size(); ++row) {
+        uint64_t step = 0;
+        std::memcpy(&step, table + row * sizeof(step), sizeof(step));
+        if (step == 0 || step > std::max<uint64_t>(header.columns, 1)) {
+            throw std::runtime_error("CWT archive has an invalid row step");
+        }
+        m_rowSteps[row] = static_cast<size_t>(step);
+    }
+    
+    // Chunks must lie in the data area; raw ones must have their exact size
+    const uint64_t dataOffset = sizeof(header) + header.rows * tableEntry;
+    const size_t elementSize = CoefficientMatrix::elementSize(m_format);
+    const size_t bands = ceilDivide(m_scales.size(), m_chunkRows);
+    m_chunks.resize(static_cast<size_t>(chunkCount));
+    std::memcpy(m_chunks.data(), m_file->data() + header.indexOffset, m_chunks.size() * sizeof(Chunk));
+    for (size_t index = 0; index < m_chunks.size(); ++index) {
+        const Chunk &chunk = m_chunks[index];
+        bool chunkValid = chunk.offset >= dataOffset && chunk.size <= header.indexOffset &&
+                          chunk.offset <= header.indexOffset - chunk.size;
+        if (chunk.codec == kCodecRaw) {
+            chunkValid = chunkValid && chunk.size == chunkBytes(m_rowSteps, m_columns, m_chunkRows, m_chunkColumns,
+                                                                elementSize, index % bands, index / bands);
+        } else if (chunk.codec != kCodecShuffleRle) {
+            chunkValid = false;
+        }
+        if (!chunkValid) {
+            throw std::runtime_error("CWT archive is truncated or corrupt");
+        }
+    }
+}
+
+CoefficientArchive::~CoefficientArchive()
+{
+}
+
+size_t CoefficientArchive::fileBytes() const
+{
+    return m_file->size();
+}
+
+size_t CoefficientArchive::matrixBytes() const
+{
+    size_t values = 0;
+    for (size_t step : m_rowSteps) {
+        values += ceilDivide(m_columns, step);
+    }
+    return values * CoefficientMatrix::elementSize(m_format);
+}
+
+std::shared_ptr<CoefficientMatrix> CoefficientArchive::read(ThreadPool *pool) const
+{
+    return decode(m_format, pool);
+}
+
+std::shared_ptr<CoefficientMatrix> CoefficientArchive::readMagnitudes(ThreadPool *pool) const
+{
+    return decode(CoefficientMatrix::MagnitudeFloat, pool);
+}
+
+std::shared_ptr<CoefficientMatrix> CoefficientArchive::decode(CoefficientMatrix::Format format,
+                                                              ThreadPool *pool) const
+{
+    PerfRecorder::Scope scope("archive read");
+    auto matrix = std::make_shared<CoefficientMatrix>(rows(), m_columns, format, m_rowSteps);
+    
+    const size_t elementSize = CoefficientMatrix::elementSize(m_format);
+    const size_t bands = ceilDivide(rows(), m_chunkRows);
+    const size_t workers = pool ? pool->threadCount() : 1;
+    std::vector<std::vector<unsigned char>> values(workers);
+    std::vector<std::vector<unsigned char>> planes(workers);
+    
+    auto decodeOne = [&](size_t index, size_t worker) {
+        const Chunk &chunk = m_chunks[index];
+        const size_t block = index / bands;
+        const size_t band = index % bands;
+        std::vector<unsigned char> &chunkValues = values[worker];
+        chunkValues.resize(chunkBytes(m_rowSteps, m_columns, m_chunkRows, m_chunkColumns, elementSize, band, block));
+        decodeChunk(m_format, chunk.codec, reinterpret_cast<const unsigned char *>(m_file->data()) + chunk.offset,
+                    chunk.size, chunkValues.size(), planes[worker], chunkValues.data());
+        
+        // Chunks cover disjoint parts of the rows, so workers never overlap
+        const unsigned char *in = chunkValues.data();
+        const size_t lastRow = std::min((band + 1) * m_chunkRows, rows());
+        for (size_t row = band * m_chunkRows; row < lastRow; ++row) {
+            size_t first = 0;
+            size_t end = 0;
+            storedRange(m_columns, m_rowSteps[row], block, m_chunkColumns, first, end);
+            if (format == m_format) {
+                std::memcpy(static_cast<unsigned char *>(matrix->rowData(row)) + first * elementSize, in,
+                            (end - first) * elementSize);
+            } else {
+                CoefficientMatrix::toMagnitudes(m_format, in, end - first,
+                                                static_cast<float *>(matrix->rowData(row)) + first);
+            }
+            in += (end - first) * elementSize;
+        }
+    };
+    if (pool) {
+        pool->parallelFor(m_chunks.size(), decodeOne);
+    } else {
+        for (size_t index = 0; index < m_chunks.size(); ++index) {
+            decodeOne(index, 0);
+        }
+    }
+    scope.setItems(static_cast<double>(rows()) * m_columns);
+    return matrix;
+}
+
+
+CoefficientArchiveSink::CoefficientArchiveSink(const std::string &path, double samplingRate, double timeOrigin)
+    : m_path(path)
+    , m_samplingRate(samplingRate)
+    , m_timeOrigin(timeOrigin)
+    , m_samples(0)
+    , m_blockStart(0)
+    , m_blockColumns(0)
+    , m_elementSize(0)
+{
+}
+
+CoefficientArchiveSink::~CoefficientArchiveSink()
+{
+}
+
+void CoefficientArchiveSink::begin(const std::vector<double> &scales, size_t samples)
+{
+    m_scales = scales;
+    m_samples = samples;
+    m_writer.reset();
+    m_blockStart = 0;
+    m_blockColumns = 0;
+}
+
+void CoefficientArchiveSink::consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns)
+{
+    if (tile.isDecimated()) {
+        throw std::invalid_argument("Decimated tiles cannot be streamed to " + m_path);
+    }
+    if (firstSample != m_blockStart + m_blockColumns || columns > m_samples - firstSample) {
+        throw std::invalid_argument("Tiles must arrive in time order");
+    }
+    
+    // As in CoefficientFileSink, only the first tile knows the format
+    if (!m_writer) {
+        m_writer.reset(new CoefficientArchive::Writer(m_path, tile.format(), m_scales,
+                                                      std::vector<size_t>(m_scales.size(), 1), m_samples,
+                                                      m_samplingRate, m_timeOrigin));
+        m_elementSize = CoefficientMatrix::elementSize(tile.format());
+        m_block.resize(m_scales.size() * CoefficientArchive::kChunkColumns * m_elementSize);
+    }
+    
+    // A tile may end one block and start the next
+    size_t done = 0;
+    while (done < columns) {
+        const size_t blockEnd = std::min(m_blockStart + CoefficientArchive::kChunkColumns, m_samples);
+        const size_t count = std::min(columns - done, blockEnd - m_blockStart - m_blockColumns);
+        for (size_t row = 0; row < tile.rows(); ++row) {
+            std::memcpy(m_block.data() + (row * CoefficientArchive::kChunkColumns + m_blockColumns) * m_elementSize,
+                        static_cast<const unsigned char *>(tile.rowData(row)) + done * m_elementSize,
+                        count * m_elementSize);
+        }
+        m_blockColumns += count;
+        done += count;
+        if (m_blockStart + m_blockColumns == blockEnd) {
+            flushBlock();
+        }
+    }
+}
+
+void CoefficientArchiveSink::flushBlock()
+{
+    const CoefficientMatrix::Format format = m_writer->format();
+    std::vector<unsigned char> chunk;
+    std::vector<unsigned char> planes;
+    std::vector<unsigned char> payload;
+    for (size_t band = 0; band < m_scales.size(); band += CoefficientArchive::kChunkRows) {
+        const size_t lastRow = std::min(band + CoefficientArchive::kChunkRows, m_scales.size());
+        chunk.resize((lastRow - band) * m_blockColumns * m_elementSize);
+        for (size_t row = band; row < lastRow; ++row) {
+            std::memcpy(chunk.data() + (row - band) * m_blockColumns * m_elementSize,
+                        m_block.data() + row * CoefficientArchive::kChunkColumns * m_elementSize,
+                        m_blockColumns * m_elementSize);
+        }
+        const uint32_t codec = encodeChunk(format, chunk.data(), chunk.size(), planes, payload);
+        m_writer->append(payload, codec);
+    }
+    m_blockStart += m_blockColumns;
+    m_blockColumns = 0;
+}
+
+void CoefficientArchiveSink::finish()
+{
+    // Nothing streamed: an empty archive still records the scales
+    if (!m_writer) {
+        m_writer.reset(new CoefficientArchive::Writer(m_path, CoefficientMatrix::ComplexDouble, m_scales,
+                                                      std::vector<size_t>(m_scales.size(), 1), m_samples,
+                                                      m_samplingRate, m_timeOrigin));
+    }
+    m_writer->finish();
+    m_writer.reset();
+}
@@ -0,0 +1,138 @@
+#ifndef COEFFICIENTARCHIVE_H
+#define COEFFICIENTARCHIVE_H
+
+#include "CoefficientMatrix.h"
+#include "CoefficientSinks.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+class ThreadPool;
+
+
+// Chunked, losslessly compressed CWT result (.mdscwz), for transforms
+// computed once and reopened many times. The matrix is cut into chunks of
+// up to chunkRows scales x chunkColumns samples; every chunk is compressed
+// on its own, so chunks can be written as a stream arrives and decoded in
+// parallel from a memory mapping. Decimated rows keep their stored values
+// only.
+//
+//   0  char[8]  magic "MDSV2CWZ"
+//   8  uint32   version (1)
+//  12  uint32   element format (CoefficientMatrix::Format)
+//  16  uint64   scale count
+//  24  uint64   samples per scale
+//  32  float64  sampling rate in Hz
+//  40  float64  time of the first sample in seconds
+//  48  uint32   scales per chunk
+//  52  uint32   samples per chunk
+//  56  uint64   offset of the chunk index
+//  64  float64  scales, one per row
+//      uint64   row steps, one per row (1 for full resolution)
+//      ...      chunk data
+//      index    per chunk: uint64 offset, uint32 size, uint32 codec
+//
+// Chunks are ordered by time block, then by scale band. A chunk holds the
+// values of its rows back to back, each row those it stores for the block.
+// Codec 1 XORs every value with the previous one of the same component,
+// splits the result into byte planes and run-length codes them: the sign,
+// exponent and top mantissa bytes of smooth CWT rows are mostly zero runs.
+// Codec 0 stores chunks that would not shrink as they are.
+class CoefficientArchive
+{
+public:
+    static const size_t kChunkRows = 16;
+    static const size_t kChunkColumns = 16384;
+    
+    // True if the file starts with the archive's magic
+    static bool isArchive(const std::string &path);
+    
+    // Writes coefficients, one scale per row, compressing chunks in
+    // parallel on pool when one is given; throws std::runtime_error on I/O
+    // errors and std::invalid_argument if scales do not match the rows
+    static void write(const std::string &path, const CoefficientMatrix &coefficients,
+                      const std::vector<double> &scales, double samplingRate, double timeOrigin,
+                      ThreadPool *pool = nullptr);
+    
+    // Maps the file and checks its header and chunk index; throws
+    // std::runtime_error if it is not a valid archive
+    explicit CoefficientArchive(const std::string &path);
+    ~CoefficientArchive();
+    
+    CoefficientArchive(const CoefficientArchive &) = delete;
+    CoefficientArchive &operator=(const CoefficientArchive &) = delete;
+    
+    CoefficientMatrix::Format format() const { return m_format; }
+    size_t rows() const { return m_scales.size(); }
+    size_t columns() const { return m_columns; }
+    const std::vector<double> &scales() const { return m_scales; }
+    const std::vector<size_t> &rowSteps() const { return m_rowSteps; }
+    double samplingRate() const { return m_samplingRate; }
+    double timeOrigin() const { return m_timeOrigin; }
+    size_t fileBytes() const;
+    // Size of the decoded matrix
+    size_t matrixBytes() const;
+    
+    // Decodes every chunk, in parallel on pool when one is given, into a
+    // matrix of the stored format, or straight to |W| (MagnitudeFloat, same
+    // row steps) for display. Throws std::runtime_error on corrupt chunks.
+    std::shared_ptr<CoefficientMatrix> read(ThreadPool *pool = nullptr) const;
+    std::shared_ptr<CoefficientMatrix> readMagnitudes(ThreadPool *pool = nullptr) const;
+
+private:
+    class Writer;
+    friend class CoefficientArchiveSink;
+    
+    struct Chunk {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t codec;
+    };
+    
+    std::shared_ptr<CoefficientMatrix> decode(CoefficientMatrix::Format format, ThreadPool *pool) const;
+    
+    std::shared_ptr<MappedFile> m_file;
+    CoefficientMatrix::Format m_format;
+    size_t m_columns;
+    double m_samplingRate;
+    double m_timeOrigin;
+    size_t m_chunkRows;
+    size_t m_chunkColumns;
+    std::vector<double> m_scales;
+    std::vector<size_t> m_rowSteps;
+    std::vector<Chunk> m_chunks;
+};
+
+
+// Streams a transform into an archive tile by tile, holding one block of
+// kChunkColumns samples of every scale. Tiles must be full resolution.
+class CoefficientArchiveSink : public CoefficientSink
+{
+public:
+    CoefficientArchiveSink(const std::string &path, double samplingRate, double timeOrigin);
+    ~CoefficientArchiveSink() override;
+    
+    void begin(const std::vector<double> &scales, size_t samples) override;
+    void consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns) override;
+    void finish() override;
+
+private:
+    void flushBlock();
+    
+    std::string m_path;
+    double m_samplingRate;
+    double m_timeOrigin;
+    std::vector<double> m_scales;
+    size_t m_samples;
+    std::unique_ptr<CoefficientArchive::Writer> m_writer;
+    std::vector<unsigned char> m_block;  // rows x kChunkColumns values of the current block
+    size_t m_blockStart;                 // first sample of the current block
+    size_t m_blockColumns;               // columns of m_block filled so far
+    size_t m_elementSize;
+};
+
+#endif
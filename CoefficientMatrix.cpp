@@ -0,0 +1,258 @@
+#include "CoefficientMatrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+
+CoefficientMatrix::CoefficientMatrix()
+    : m_rows(0)
+    , m_columns(0)
+    , m_stride(0)
+    , m_format(ComplexDouble)
+{
+}
+
+CoefficientMatrix::CoefficientMatrix(size_t rows, size_t columns, Format format)
+    : m_rows(rows)
+    , m_columns(columns)
+    , m_format(format)
+{
+    allocate();
+}
+
+CoefficientMatrix::CoefficientMatrix(size_t rows, size_t columns, Format format, const std::vector<size_t> &rowSteps)
+    : m_rows(rows)
+    , m_columns(columns)
+    , m_format(format)
+{
+    if (rowSteps.size() != rows) {
+        throw std::invalid_argument("One decimation step per coefficient row is required");
+    }
+    
+    // A matrix without any decimated row keeps the plain layout
+    if (std::any_of(rowSteps.begin(), rowSteps.end(), [](size_t step) { return step != 1; })) {
+        m_rowSteps = rowSteps;
+        for (size_t &step : m_rowSteps) {
+            step = std::max<size_t>(step, 1);
+        }
+    }
+    allocate();
+}
+
+void CoefficientMatrix::allocate()
+{
+    const size_t size = elementSize(m_format);
+    const size_t perLine = Alignment / size;
+    m_stride = (m_columns + perLine - 1) / perLine * perLine;
+    
+    // Every row starts on an alignment boundary, decimated or not
+    m_offsets.resize(m_rows + 1);
+    m_offsets[0] = 0;
+    for (size_t row = 0; row < m_rows; ++row) {
+        const size_t rowStride = (rowColumns(row) + perLine - 1) / perLine * perLine;
+        if (rowStride > (size_t(-1) / size - m_offsets[row])) {
+            throw std::length_error("CWT coefficient matrix is too large");
+        }
+        m_offsets[row + 1] = m_offsets[row] + rowStride;
+    }
+    
+    // Pages are only committed once the engine writes them, so a large
+    // matrix costs nothing until rows are actually computed
+    const size_t byteCount = m_offsets[m_rows] * size;
+    if (byteCount != 0) {
+        void *storage = ::operator new(byteCount, std::align_val_t(Alignment));
+        m_data.reset(static_cast<unsigned char *>(storage));
+    }
+}
+
+CoefficientMatrix::CoefficientMatrix(CoefficientMatrix &&other) noexcept
+    : m_data(std::move(other.m_data))
+    , m_rows(other.m_rows)
+    , m_columns(other.m_columns)
+    , m_stride(other.m_stride)
+    , m_format(other.m_format)
+    , m_rowSteps(std::move(other.m_rowSteps))
+    , m_offsets(std::move(other.m_offsets))
+{
+    other.m_rows = 0;
+    other.m_columns = 0;
+    other.m_stride = 0;
+}
+
+CoefficientMatrix &CoefficientMatrix::operator=(CoefficientMatrix &&other) noexcept
+{
+    if (this != &other) {
+        m_data = std::move(other.m_data);
+        m_rows = other.m_rows;
+        m_columns = other.m_columns;
+        m_stride = other.m_stride;
+        m_format = other.m_format;
+        m_rowSteps = std::move(other.m_rowSteps);
+        m_offsets = std::move(other.m_offsets);
+        other.m_rows = 0;
+        other.m_columns = 0;
+        other.m_stride = 0;
+    }
+    return *this;
+}
+
+size_t CoefficientMatrix::elementSize(Format format)
+{
+    switch (format) {
+        case ComplexDouble: return sizeof(std::complex<double>);
+        case ComplexFloat: return sizeof(std::complex<float>);
+        case MagnitudeFloat: return sizeof(float);
+        case PowerFloat: return sizeof(float);
+    }
+    return sizeof(std::complex<double>);
+}
+
+void CoefficientMatrix::storeRow(size_t index, const std::complex<double> *values)
+{
+    const size_t columns = rowColumns(index);
+    switch (m_format) {
+        case ComplexDouble: {
+            auto out = row<std::complex<double>>(index);
+            if (values != out.data()) {
+                std::copy(values, values + columns, out.begin());
+            }
+            break;
+        }
+        case ComplexFloat: {
+            auto out = row<std::complex<float>>(index);
+            for (size_t i = 0; i < columns; ++i) {
+                out[i] = std::complex<float>(static_cast<float>(values[i].real()),
+                                             static_cast<float>(values[i].imag()));
+            }
+            break;
+        }
+        case MagnitudeFloat: {
+            // sqrt of the norm instead of std::abs: no overflow guard needed
+            // at these magnitudes, and it vectorizes
+            auto out = row<float>(index);
+            for (size_t i = 0; i < columns; ++i) {
+                double re = values[i].real();
+                double im = values[i].imag();
+                out[i] = static_cast<float>(std::sqrt(re * re + im * im));
+            }
+            break;
+        }
+        case PowerFloat: {
+            auto out = row<float>(index);
+            for (size_t i = 0; i < columns; ++i) {
+                double re = values[i].real();
+                double im = values[i].imag();
+                out[i] = static_cast<float>(re * re + im * im);
+            }
+            break;
+        }
+    }
+}
+
+void CoefficientMatrix::copyRow(size_t index, size_t first, const CoefficientMatrix &source, size_t sourceRow,
+                                size_t sourceFirst, size_t count)
+{
+    if (source.m_format != m_format) {
+        throw std::invalid_argument("Rows can only be copied between matrices of the same format");
+    }
+    if (index >= m_rows || sourceRow >= source.m_rows || first + count > rowColumns(index) ||
+        sourceFirst + count > source.rowColumns(sourceRow)) {
+        throw std::invalid_argument("Row copy out of range");
+    }
+    const size_t size = elementSize(m_format);
+    std::memcpy(m_data.get() + (m_offsets[index] + first) * size,
+                source.m_data.get() + (source.m_offsets[sourceRow] + sourceFirst) * size, count * size);
+}
+
+void CoefficientMatrix::magnitudes(size_t index, float *out) const
+{
+    const size_t columns = rowColumns(index);
+    storedMagnitudes(index, 0, columns, out);
+    
+    // Expand the stored values in place, from the end so that every value
+    // is read before its slot is overwritten
+    const size_t step = rowStep(index);
+    if (step > 1 && columns > 0) {
+        for (size_t column = m_columns; column-- > 0;) {
+            const size_t stored = column / step;
+            const float fraction = static_cast<float>(column % step) / static_cast<float>(step);
+            const float left = out[stored];
+            const float right = out[std::min(stored + 1, columns - 1)];
+            out[column] = left + (right - left) * fraction;
+        }
+    }
+}
+
+void CoefficientMatrix::magnitudes(size_t index, size_t firstColumn, size_t count, float *out) const
+{
+    const size_t step = rowStep(index);
+    if (step == 1) {
+        storedMagnitudes(index, firstColumn, count, out);
+        return;
+    }
+    if (count == 0) {
+        return;
+    }
+    
+    // The stored values bracketing the range, interpolated as above
+    const size_t firstStored = firstColumn / step;
+    const size_t lastStored = std::min((firstColumn + count - 1) / step + 1, rowColumns(index) - 1);
+    std::vector<float> stored(lastStored - firstStored + 1);
+    storedMagnitudes(index, firstStored, stored.size(), stored.data());
+    for (size_t i = 0; i < count; ++i) {
+        const size_t column = firstColumn + i;
+        const size_t left = column / step - firstStored;
+        const float fraction = static_cast<float>(column % step) / static_cast<float>(step);
+        const float right = stored[std::min(left + 1, stored.size() - 1)];
+        out[i] = stored[left] + (right - stored[left]) * fraction;
+    }
+}
+
+void CoefficientMatrix::storedMagnitudes(size_t index, size_t first, size_t count, float *out) const
+{
+    toMagnitudes(m_format, m_data.get() + (m_offsets[index] + first) * elementSize(m_format), count, out);
+}
+
+void CoefficientMatrix::toMagnitudes(Format format, const void *values, size_t count, float *out)
+{
+    switch (format) {
+        case ComplexDouble: {
+            const std::complex<double> *complexValues = static_cast<const std::complex<double> *>(values);
+            for (size_t i = 0; i < count; ++i) {
+                double re = complexValues[i].real();
+                double im = complexValues[i].imag();
+                out[i] = static_cast<float>(std::sqrt(re * re + im * im));
+            }
+            break;
+        }
+        case ComplexFloat: {
+            const std::complex<float> *complexValues = static_cast<const std::complex<float> *>(values);
+            for (size_t i = 0; i < count; ++i) {
+                float re = complexValues[i].real();
+                float im = complexValues[i].imag();
+                out[i] = std::sqrt(re * re + im * im);
+            }
+            break;
+        }
+        case MagnitudeFloat: {
+            const float *floatValues = static_cast<const float *>(values);
+            std::copy(floatValues, floatValues + count, out);
+            break;
+        }
+        case PowerFloat: {
+            const float *floatValues = static_cast<const float *>(values);
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = std::sqrt(floatValues[i]);
+            }
+            break;
+        }
+    }
+}
+
+void CoefficientMatrix::AlignedDelete::operator()(unsigned char *data) const
+{
+    ::operator delete(static_cast<void *>(data), std::align_val_t(Alignment));
+}
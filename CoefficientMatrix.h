@@ -0,0 +1,132 @@
+#ifndef COEFFICIENTMATRIX_H
+#define COEFFICIENTMATRIX_H
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+// Dense scale x time matrix of CWT coefficients held in one 64-byte
+// aligned allocation. Every row starts on an alignment boundary, so rows
+// can be handed to the SIMD kernels, the image code and exporters as is.
+// Rows may be decimated: row i then holds every rowStep(i)-th column only.
+// Not copyable: results are shared through shared_ptr or moved.
+class CoefficientMatrix
+{
+public:
+    // Element type of the matrix. The engines compute in double precision
+    // and convert each finished row with storeRow().
+    enum Format {
+        ComplexDouble = 0,  // std::complex<double>, 16 bytes
+        ComplexFloat = 1,   // std::complex<float>, 8 bytes
+        MagnitudeFloat = 2, // float |W|, 4 bytes
+        PowerFloat = 3      // float |W|^2, 4 bytes
+    };
+    
+    // Non-owning view of one contiguous row
+    template <typename T>
+    class RowView {
+    public:
+        RowView(T *data, size_t size) : m_data(data), m_size(size) {}
+        
+        T *data() const { return m_data; }
+        size_t size() const { return m_size; }
+        T *begin() const { return m_data; }
+        T *end() const { return m_data + m_size; }
+        T &operator[](size_t index) const { return m_data[index]; }
+    
+    private:
+        T *m_data;
+        size_t m_size;
+    };
+    
+    static const size_t Alignment = 64;
+    
+    CoefficientMatrix();
+    // Contents start uninitialized; the engines write every row
+    CoefficientMatrix(size_t rows, size_t columns, Format format = ComplexDouble);
+    // Row i stores columns 0, rowSteps[i], 2 * rowSteps[i], ... only
+    CoefficientMatrix(size_t rows, size_t columns, Format format, const std::vector<size_t> &rowSteps);
+    
+    CoefficientMatrix(CoefficientMatrix &&other) noexcept;
+    CoefficientMatrix &operator=(CoefficientMatrix &&other) noexcept;
+    CoefficientMatrix(const CoefficientMatrix &) = delete;
+    CoefficientMatrix &operator=(const CoefficientMatrix &) = delete;
+    
+    size_t rows() const { return m_rows; }
+    // Full-resolution width; decimated rows store fewer values
+    size_t columns() const { return m_columns; }
+    Format format() const { return m_format; }
+    bool isComplex() const { return m_format == ComplexDouble || m_format == ComplexFloat; }
+    // Distance between consecutive full-resolution rows in elements
+    // (columns rounded up to the alignment)
+    size_t stride() const { return m_stride; }
+    bool empty() const { return m_rows == 0 || m_columns == 0; }
+    size_t bytes() const { return m_offsets.empty() ? 0 : m_offsets.back() * elementSize(m_format); }
+    
+    bool isDecimated() const { return !m_rowSteps.empty(); }
+    // Column distance between the stored values of row index
+    size_t rowStep(size_t index) const { return m_rowSteps.empty() ? 1 : m_rowSteps[index]; }
+    // Number of values stored in row index
+    size_t rowColumns(size_t index) const { return (m_columns + rowStep(index) - 1) / rowStep(index); }
+    
+    static size_t elementSize(Format format);
+    // |W| of count values of format, laid out as a row stores them
+    static void toMagnitudes(Format format, const void *values, size_t count, float *out);
+    
+    // T must be the element type of format(): std::complex<double>,
+    // std::complex<float> or float
+    template <typename T = std::complex<double>>
+    RowView<T> row(size_t index)
+    {
+        return RowView<T>(reinterpret_cast<T *>(m_data.get() + m_offsets[index] * sizeof(T)), rowColumns(index));
+    }
+    template <typename T = std::complex<double>>
+    RowView<const T> row(size_t index) const
+    {
+        return RowView<const T>(reinterpret_cast<const T *>(m_data.get() + m_offsets[index] * sizeof(T)),
+                                rowColumns(index));
+    }
+    
+    // Raw bytes of row index, rowColumns(index) * elementSize(format()) long
+    const void *rowData(size_t index) const { return m_data.get() + m_offsets[index] * elementSize(m_format); }
+    void *rowData(size_t index) { return m_data.get() + m_offsets[index] * elementSize(m_format); }
+    
+    // Converts rowColumns(index) double-precision coefficients into row
+    // index. For ComplexDouble, values may already point at that row.
+    void storeRow(size_t index, const std::complex<double> *values);
+    
+    // Copies count stored values of row sourceRow of source, from stored
+    // value sourceFirst on, into row index from stored value first on.
+    // Formats must match; throws std::invalid_argument otherwise or when
+    // either range runs past its row.
+    void copyRow(size_t index, size_t first, const CoefficientMatrix &source, size_t sourceRow,
+                 size_t sourceFirst, size_t count);
+    
+    // |W| of row index, whatever the storage format, at full resolution:
+    // columns() values, linearly interpolated between the stored ones of a
+    // decimated row
+    void magnitudes(size_t index, float *out) const;
+    // The same for count columns from firstColumn only
+    void magnitudes(size_t index, size_t firstColumn, size_t count, float *out) const;
+
+private:
+    void allocate();
+    // |W| of count stored values of row index, from stored value first
+    void storedMagnitudes(size_t index, size_t first, size_t count, float *out) const;
+    
+    struct AlignedDelete {
+        void operator()(unsigned char *data) const;
+    };
+    
+    std::unique_ptr<unsigned char[], AlignedDelete> m_data;
+    size_t m_rows;
+    size_t m_columns;
+    size_t m_stride;
+    Format m_format;
+    std::vector<size_t> m_rowSteps;  // empty when no row is decimated
+    std::vector<size_t> m_offsets;   // element offset of every row, plus the end
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "CoefficientSinks.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+
+ScalogramOverviewSink::ScalogramOverviewSink(size_t maxColumns)
+    : m_maxColumns(std::max<size_t>(maxColumns, 1))
+    , m_samples(0)
+{
+}
+
+void ScalogramOverviewSink::begin(const std::vector<double> &scales, size_t samples)
+{
+    m_samples = samples;
+    const size_t columns = std::min(samples, m_maxColumns);
+    m_overview = std::make_shared<CoefficientMatrix>(scales.size(), columns, CoefficientMatrix::MagnitudeFloat);
+    for (size_t row = 0; row < m_overview->rows(); ++row) {
+        auto values = m_overview->row<float>(row);
+        std::fill(values.begin(), values.end(), 0.0f);
+    }
+}
+
+size_t ScalogramOverviewSink::columnStart(size_t column) const
+{
+    const size_t columns = m_overview ? m_overview->columns() : 0;
+    // Inverse of the sample -> column mapping in consumeTile
+    return columns == 0 ? 0 : static_cast<size_t>((static_cast<unsigned long long>(column) * m_samples + columns - 1)
+                                                  / columns);
+}
+
+void ScalogramOverviewSink::consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns)
+{
+    const size_t overviewColumns = m_overview->columns();
+    m_magnitudes.resize(tile.columns());
+    
+    for (size_t row = 0; row < tile.rows(); ++row) {
+        tile.magnitudes(row, m_magnitudes.data());
+        auto out = m_overview->row<float>(row);
+        
+        for (size_t i = 0; i < columns; ++i) {
+            size_t sample = firstSample + i;
+            size_t column = static_cast<size_t>(static_cast<unsigned long long>(sample) * overviewColumns / m_samples);
+            out[column] = std::max(out[column], m_magnitudes[i]);
+        }
+    }
+}
+
+
+PowerConversionSink::PowerConversionSink(const std::shared_ptr<CoefficientSink> &target)
+    : m_target(target)
+{
+}
+
+void PowerConversionSink::begin(const std::vector<double> &scales, size_t samples)
+{
+    m_target->begin(scales, samples);
+}
+
+void PowerConversionSink::consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns)
+{
+    if (m_tile.rows() != tile.rows() || m_tile.columns() != tile.columns()) {
+        m_tile = CoefficientMatrix(tile.rows(), tile.columns(), CoefficientMatrix::PowerFloat);
+    }
+    m_magnitudes.resize(tile.columns());
+    
+    for (size_t row = 0; row < tile.rows(); ++row) {
+        tile.magnitudes(row, m_magnitudes.data());
+        auto out = m_tile.row<float>(row);
+        for (size_t i = 0; i < columns; ++i) {
+            out[i] = m_magnitudes[i] * m_magnitudes[i];
+        }
+    }
+    m_target->consumeTile(m_tile, firstSample, columns);
+}
+
+void PowerConversionSink::finish()
+{
+    m_target->finish();
+}
+
+
+static const char kMagic[8] = {'M', 'D', 'S', 'V', '2', 'C', 'W', 'T'};
+static const uint32_t kVersion = 1;
+static const uint64_t kDataAlignment = 4096;
+
+struct CoefficientFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint64_t rows;
+    uint64_t columns;
+    double samplingRate;
+    double timeOrigin;
+    uint64_t dataOffset;
+};
+
+static_assert(sizeof(CoefficientFileHeader) == 56, "CoefficientFileHeader must match the on-disk layout");
+
+CoefficientFileSink::CoefficientFileSink(const std::string &path, double samplingRate, double timeOrigin)
+    : m_path(path)
+    , m_samplingRate(samplingRate)
+    , m_timeOrigin(timeOrigin)
+    , m_rows(0)
+    , m_samples(0)
+    , m_dataOffset(0)
+    , m_headerWritten(false)
+{
+    m_out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_out) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+}
+
+void CoefficientFileSink::begin(const std::vector<double> &scales, size_t samples)
+{
+    m_rows = scales.size();
+    m_samples = samples;
+    m_headerWritten = false;
+    
+    const uint64_t scalesEnd = sizeof(CoefficientFileHeader) + m_rows * sizeof(double);
+    m_dataOffset = (scalesEnd + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+    
+    m_out.seekp(sizeof(CoefficientFileHeader));
+    m_out.write(reinterpret_cast<const char *>(scales.data()), scales.size() * sizeof(double));
+    if (!m_out) {
+        throw std::runtime_error("Failed to write " + m_path);
+    }
+}
+
+void CoefficientFileSink::consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns)
+{
+    // The file layout has full-resolution rows only
+    if (tile.isDecimated()) {
+        throw std::invalid_argument("Decimated coefficients cannot be written to " + m_path);
+    }
+    
+    // The header needs the element format, which only the first tile knows
+    if (!m_headerWritten) {
+        CoefficientFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.format = tile.format();
+        header.rows = m_rows;
+        header.columns = m_samples;
+        header.samplingRate = m_samplingRate;
+        header.timeOrigin = m_timeOrigin;
+        header.dataOffset = m_dataOffset;
+        
+        m_out.seekp(0);
+        m_out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        m_headerWritten = true;
+    }
+    
+    const size_t elementSize = CoefficientMatrix::elementSize(tile.format());
+    for (size_t row = 0; row < tile.rows(); ++row) {
+        const uint64_t offset = m_dataOffset + (static_cast<uint64_t>(row) * m_samples + firstSample) * elementSize;
+        m_out.seekp(static_cast<std::streamoff>(offset));
+        m_out.write(static_cast<const char *>(tile.rowData(row)), columns * elementSize);
+    }
+    
+    if (!m_out) {
+        throw std::runtime_error("Failed to write " + m_path);
+    }
+}
+
+void CoefficientFileSink::finish()
+{
+    m_out.close();
+    if (!m_out) {
+        throw std::runtime_error("Failed to write " + m_path);
+    }
+}
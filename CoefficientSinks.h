@@ -0,0 +1,102 @@
+#ifndef COEFFICIENTSINKS_H
+#define COEFFICIENTSINKS_H
+
+#include "CoefficientMatrix.h"
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Receives a streamed CWT one tile at a time. Tiles arrive in time order
+// on the analysis thread; each covers every scale for the samples
+// [firstSample, firstSample + columns). Only the first columns of the
+// tile are valid (the last tile is usually shorter than the others).
+class CoefficientSink
+{
+public:
+    virtual ~CoefficientSink() {}
+    
+    virtual void begin(const std::vector<double> &scales, size_t samples) = 0;
+    virtual void consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns) = 0;
+    virtual void finish() {}
+};
+
+
+// Reduces the stream to a fixed-width magnitude image for the scalogram:
+// each output column keeps the peak |W| of the samples it covers, so
+// short transients stay visible at any zoom-out.
+class ScalogramOverviewSink : public CoefficientSink
+{
+public:
+    explicit ScalogramOverviewSink(size_t maxColumns);
+    
+    void begin(const std::vector<double> &scales, size_t samples) override;
+    void consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns) override;
+    
+    // MagnitudeFloat matrix, scales x overviewColumns
+    std::shared_ptr<CoefficientMatrix> overview() const { return m_overview; }
+    // First input sample covered by overview column
+    size_t columnStart(size_t column) const;
+
+private:
+    size_t m_maxColumns;
+    size_t m_samples;
+    std::shared_ptr<CoefficientMatrix> m_overview;
+    std::vector<float> m_magnitudes;
+};
+
+
+// Hands |W|^2 of every tile, as PowerFloat, on to another sink, so power
+// can be written next to the full coefficients of the same transform.
+class PowerConversionSink : public CoefficientSink
+{
+public:
+    explicit PowerConversionSink(const std::shared_ptr<CoefficientSink> &target);
+    
+    void begin(const std::vector<double> &scales, size_t samples) override;
+    void consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns) override;
+    void finish() override;
+
+private:
+    std::shared_ptr<CoefficientSink> m_target;
+    CoefficientMatrix m_tile;
+    std::vector<float> m_magnitudes;
+};
+
+
+// Writes the full coefficient matrix to a raw file, row-major by scale,
+// without ever holding more than one tile:
+//
+//   0  char[8]  magic "MDSV2CWT"
+//   8  uint32   version (1)
+//  12  uint32   element format (CoefficientMatrix::Format)
+//  16  uint64   scale count
+//  24  uint64   samples per scale
+//  32  float64  sampling rate in Hz
+//  40  float64  time of the first sample in seconds
+//  48  uint64   offset of the first row; the scales follow the header
+//               as float64 values, rows are contiguous after the offset
+class CoefficientFileSink : public CoefficientSink
+{
+public:
+    CoefficientFileSink(const std::string &path, double samplingRate, double timeOrigin);
+    
+    void begin(const std::vector<double> &scales, size_t samples) override;
+    void consumeTile(const CoefficientMatrix &tile, size_t firstSample, size_t columns) override;
+    void finish() override;
+
+private:
+    std::string m_path;
+    double m_samplingRate;
+    double m_timeOrigin;
+    std::ofstream m_out;
+    size_t m_rows;
+    size_t m_samples;
+    unsigned long long m_dataOffset;
+    bool m_headerWritten;
+};
+
+#endif
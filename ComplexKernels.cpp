@@ -0,0 +1,200 @@
+#include "ComplexKernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define COMPLEXKERNELS_X86
+#include <immintrin.h>
+#endif
+
+static void realComplexDotScalar(const double *x, const double *real, const double *imag,
+                                 size_t count, double *outReal, double *outImag)
+{
+    double sumReal = 0.0;
+    double sumImag = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        sumReal += x[i] * real[i];
+        sumImag += x[i] * imag[i];
+    }
+    *outReal = sumReal;
+    *outImag = sumImag;
+}
+
+static void multiplyScalar(const double *aReal, const double *aImag,
+                           const double *bReal, const double *bImag,
+                           std::complex<double> *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = std::complex<double>(aReal[i] * bReal[i] - aImag[i] * bImag[i],
+                                      aReal[i] * bImag[i] + aImag[i] * bReal[i]);
+    }
+}
+
+#ifdef COMPLEXKERNELS_X86
+
+__attribute__((target("avx2,fma")))
+static double horizontalSum(__m256d v)
+{
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    low = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+__attribute__((target("avx2,fma")))
+static void realComplexDotAvx2(const double *x, const double *real, const double *imag,
+                               size_t count, double *outReal, double *outImag)
+{
+    // Two accumulator pairs hide the FMA latency
+    __m256d accReal0 = _mm256_setzero_pd();
+    __m256d accImag0 = _mm256_setzero_pd();
+    __m256d accReal1 = _mm256_setzero_pd();
+    __m256d accImag1 = _mm256_setzero_pd();
+    
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d x0 = _mm256_loadu_pd(x + i);
+        __m256d x1 = _mm256_loadu_pd(x + i + 4);
+        accReal0 = _mm256_fmadd_pd(x0, _mm256_loadu_pd(real + i), accReal0);
+        accImag0 = _mm256_fmadd_pd(x0, _mm256_loadu_pd(imag + i), accImag0);
+        accReal1 = _mm256_fmadd_pd(x1, _mm256_loadu_pd(real + i + 4), accReal1);
+        accImag1 = _mm256_fmadd_pd(x1, _mm256_loadu_pd(imag + i + 4), accImag1);
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m256d x0 = _mm256_loadu_pd(x + i);
+        accReal0 = _mm256_fmadd_pd(x0, _mm256_loadu_pd(real + i), accReal0);
+        accImag0 = _mm256_fmadd_pd(x0, _mm256_loadu_pd(imag + i), accImag0);
+    }
+    
+    double sumReal = horizontalSum(_mm256_add_pd(accReal0, accReal1));
+    double sumImag = horizontalSum(_mm256_add_pd(accImag0, accImag1));
+    for (; i < count; ++i) {
+        sumReal += x[i] * real[i];
+        sumImag += x[i] * imag[i];
+    }
+    *outReal = sumReal;
+    *outImag = sumImag;
+}
+
+__attribute__((target("avx2,fma")))
+static void multiplyAvx2(const double *aReal, const double *aImag,
+                         const double *bReal, const double *bImag,
+                         std::complex<double> *out, size_t count)
+{
+    double *dst = reinterpret_cast<double *>(out);
+    
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d ar = _mm256_loadu_pd(aReal + i);
+        __m256d ai = _mm256_loadu_pd(aImag + i);
+        __m256d br = _mm256_loadu_pd(bReal + i);
+        __m256d bi = _mm256_loadu_pd(bImag + i);
+        
+        __m256d re = _mm256_fmsub_pd(ar, br, _mm256_mul_pd(ai, bi));
+        __m256d im = _mm256_fmadd_pd(ar, bi, _mm256_mul_pd(ai, br));
+        
+        // [re0 im0 re2 im2] and [re1 im1 re3 im3] -> interleaved pairs in order
+        __m256d low = _mm256_unpacklo_pd(re, im);
+        __m256d high = _mm256_unpackhi_pd(re, im);
+        _mm256_storeu_pd(dst + 2 * i, _mm256_permute2f128_pd(low, high, 0x20));
+        _mm256_storeu_pd(dst + 2 * i + 4, _mm256_permute2f128_pd(low, high, 0x31));
+    }
+    // The tail stays inline: tail-calling the non-AVX scalar routine would
+    // skip vzeroupper and stall any SSE code that runs afterwards
+    for (; i < count; ++i) {
+        out[i] = std::complex<double>(aReal[i] * bReal[i] - aImag[i] * bImag[i],
+                                      aReal[i] * bImag[i] + aImag[i] * bReal[i]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static double horizontalSum(__m512d v)
+{
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, v);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+__attribute__((target("avx512f")))
+static void realComplexDotAvx512(const double *x, const double *real, const double *imag,
+                                 size_t count, double *outReal, double *outImag)
+{
+    __m512d accReal0 = _mm512_setzero_pd();
+    __m512d accImag0 = _mm512_setzero_pd();
+    __m512d accReal1 = _mm512_setzero_pd();
+    __m512d accImag1 = _mm512_setzero_pd();
+    
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512d x0 = _mm512_loadu_pd(x + i);
+        __m512d x1 = _mm512_loadu_pd(x + i + 8);
+        accReal0 = _mm512_fmadd_pd(x0, _mm512_loadu_pd(real + i), accReal0);
+        accImag0 = _mm512_fmadd_pd(x0, _mm512_loadu_pd(imag + i), accImag0);
+        accReal1 = _mm512_fmadd_pd(x1, _mm512_loadu_pd(real + i + 8), accReal1);
+        accImag1 = _mm512_fmadd_pd(x1, _mm512_loadu_pd(imag + i + 8), accImag1);
+    }
+    
+    // Masked loads cover the tail without a scalar loop
+    while (i < count) {
+        size_t remaining = count - i;
+        __mmask8 mask = remaining >= 8 ? __mmask8(0xFF) : __mmask8((1u << remaining) - 1);
+        __m512d x0 = _mm512_maskz_loadu_pd(mask, x + i);
+        accReal0 = _mm512_fmadd_pd(x0, _mm512_maskz_loadu_pd(mask, real + i), accReal0);
+        accImag0 = _mm512_fmadd_pd(x0, _mm512_maskz_loadu_pd(mask, imag + i), accImag0);
+        i += remaining >= 8 ? 8 : remaining;
+    }
+    
+    *outReal = horizontalSum(_mm512_add_pd(accReal0, accReal1));
+    *outImag = horizontalSum(_mm512_add_pd(accImag0, accImag1));
+}
+
+__attribute__((target("avx512f")))
+static void multiplyAvx512(const double *aReal, const double *aImag,
+                           const double *bReal, const double *bImag,
+                           std::complex<double> *out, size_t count)
+{
+    double *dst = reinterpret_cast<double *>(out);
+    const __m512i lowPairs = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+    const __m512i highPairs = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+    
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d ar = _mm512_loadu_pd(aReal + i);
+        __m512d ai = _mm512_loadu_pd(aImag + i);
+        __m512d br = _mm512_loadu_pd(bReal + i);
+        __m512d bi = _mm512_loadu_pd(bImag + i);
+        
+        __m512d re = _mm512_fmsub_pd(ar, br, _mm512_mul_pd(ai, bi));
+        __m512d im = _mm512_fmadd_pd(ar, bi, _mm512_mul_pd(ai, br));
+        
+        _mm512_storeu_pd(dst + 2 * i, _mm512_permutex2var_pd(re, lowPairs, im));
+        _mm512_storeu_pd(dst + 2 * i + 8, _mm512_permutex2var_pd(re, highPairs, im));
+    }
+    for (; i < count; ++i) {
+        out[i] = std::complex<double>(aReal[i] * bReal[i] - aImag[i] * bImag[i],
+                                      aReal[i] * bImag[i] + aImag[i] * bReal[i]);
+    }
+}
+
+#endif
+
+const ComplexKernels &ComplexKernels::scalar()
+{
+    static const ComplexKernels kernels = {realComplexDotScalar, multiplyScalar, "scalar"};
+    return kernels;
+}
+
+const ComplexKernels &ComplexKernels::instance()
+{
+    static const ComplexKernels kernels = []() {
+#ifdef COMPLEXKERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return ComplexKernels{realComplexDotAvx512, multiplyAvx512, "AVX-512"};
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return ComplexKernels{realComplexDotAvx2, multiplyAvx2, "AVX2"};
+        }
+#endif
+        return scalar();
+    }();
+    return kernels;
+}
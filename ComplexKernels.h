@@ -0,0 +1,30 @@
+#ifndef COMPLEXKERNELS_H
+#define COMPLEXKERNELS_H
+
+#include <complex>
+#include <cstddef>
+
+
+// Split real/imaginary (SoA) complex kernels for the CWT inner loops.
+// instance() picks the widest implementation the CPU supports at runtime
+// (AVX-512, AVX2+FMA or portable scalar), so one binary runs everywhere.
+struct ComplexKernels
+{
+    // (*outReal, *outImag) = sum_i x[i] * (real[i] + j imag[i])
+    using RealComplexDotFn = void (*)(const double *x, const double *real, const double *imag,
+                                      size_t count, double *outReal, double *outImag);
+    
+    // out[i] = (aReal[i] + j aImag[i]) * (bReal[i] + j bImag[i]), written interleaved
+    using MultiplyFn = void (*)(const double *aReal, const double *aImag,
+                                const double *bReal, const double *bImag,
+                                std::complex<double> *out, size_t count);
+    
+    RealComplexDotFn realComplexDot;
+    MultiplyFn multiply;
+    const char *name;
+    
+    static const ComplexKernels &instance();
+    static const ComplexKernels &scalar();
+};
+
+#endif
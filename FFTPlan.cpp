@@ -0,0 +1,143 @@
+#include "FFTPlan.h"
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+
+size_t FFTPlan::nextPowerOfTwo(size_t n)
+{
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+#ifdef USE_FFTW3
+
+// FFTW's planner keeps global state: only fftw_execute* may run on several
+// threads at once, so plans are created and destroyed one at a time
+static std::mutex s_plannerMutex;
+
+FFTPlan::FFTPlan(size_t size)
+    : m_size(size)
+    , m_forwardPlan(nullptr)
+    , m_inversePlan(nullptr)
+{
+    if (size == 0 || (size & (size - 1)) != 0) {
+        throw std::invalid_argument("FFT size must be a power of two");
+    }
+    
+    // Plans are created on a scratch buffer and later executed on caller
+    // buffers, so they must not assume SIMD alignment
+    std::lock_guard<std::mutex> lock(s_plannerMutex);
+    fftw_complex *scratch = fftw_alloc_complex(size);
+    const unsigned flags = FFTW_ESTIMATE | FFTW_UNALIGNED;
+    m_forwardPlan = fftw_plan_dft_1d(static_cast<int>(size), scratch, scratch, FFTW_FORWARD, flags);
+    m_inversePlan = fftw_plan_dft_1d(static_cast<int>(size), scratch, scratch, FFTW_BACKWARD, flags);
+    fftw_free(scratch);
+    
+    if (!m_forwardPlan || !m_inversePlan) {
+        if (m_forwardPlan) fftw_destroy_plan(m_forwardPlan);
+        if (m_inversePlan) fftw_destroy_plan(m_inversePlan);
+        throw std::runtime_error("Failed to create FFTW plan");
+    }
+}
+
+FFTPlan::~FFTPlan()
+{
+    std::lock_guard<std::mutex> lock(s_plannerMutex);
+    if (m_forwardPlan) fftw_destroy_plan(m_forwardPlan);
+    if (m_inversePlan) fftw_destroy_plan(m_inversePlan);
+}
+
+void FFTPlan::forward(std::complex<double> *data) const
+{
+    auto *buffer = reinterpret_cast<fftw_complex *>(data);
+    fftw_execute_dft(m_forwardPlan, buffer, buffer);
+}
+
+void FFTPlan::inverse(std::complex<double> *data) const
+{
+    auto *buffer = reinterpret_cast<fftw_complex *>(data);
+    fftw_execute_dft(m_inversePlan, buffer, buffer);
+}
+
+const char *FFTPlan::backendName()
+{
+    return "FFTW3";
+}
+
+#else
+
+FFTPlan::FFTPlan(size_t size)
+    : m_size(size)
+{
+    if (size == 0 || (size & (size - 1)) != 0) {
+        throw std::invalid_argument("FFT size must be a power of two");
+    }
+    
+    m_twiddles.resize(size / 2);
+    for (size_t k = 0; k < size / 2; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+        m_twiddles[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+    
+    int bits = 0;
+    while ((size_t(1) << bits) < size) {
+        ++bits;
+    }
+    m_bitReverse.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        size_t reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (size_t(1) << b)) {
+                reversed |= size_t(1) << (bits - 1 - b);
+            }
+        }
+        m_bitReverse[i] = reversed;
+    }
+}
+
+FFTPlan::~FFTPlan() = default;
+
+void FFTPlan::forward(std::complex<double> *data) const
+{
+    transform(data, false);
+}
+
+void FFTPlan::inverse(std::complex<double> *data) const
+{
+    transform(data, true);
+}
+
+void FFTPlan::transform(std::complex<double> *data, bool inverse) const
+{
+    for (size_t i = 0; i < m_size; ++i) {
+        size_t j = m_bitReverse[i];
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+    
+    for (size_t half = 1; half < m_size; half <<= 1) {
+        const size_t twiddleStride = m_size / (2 * half);
+        for (size_t start = 0; start < m_size; start += 2 * half) {
+            for (size_t k = 0; k < half; ++k) {
+                std::complex<double> w = m_twiddles[k * twiddleStride];
+                if (inverse) {
+                    w = std::conj(w);
+                }
+                std::complex<double> odd = w * data[start + k + half];
+                data[start + k + half] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+}
+
+const char *FFTPlan::backendName()
+{
+    return "built-in radix-2";
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef FFTPLAN_H
+#define FFTPLAN_H
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+#ifdef USE_FFTW3
+#include <fftw3.h>
+#endif
+
+
+// In-place complex FFT of a fixed power-of-two length.
+// Uses FFTW3 when the build found it, otherwise a built-in radix-2 transform.
+class FFTPlan
+{
+public:
+    explicit FFTPlan(size_t size);
+    ~FFTPlan();
+
+    FFTPlan(const FFTPlan &) = delete;
+    FFTPlan &operator=(const FFTPlan &) = delete;
+
+    size_t size() const { return m_size; }
+
+    void forward(std::complex<double> *data) const;
+    // Unnormalized: forward followed by inverse scales the data by size()
+    void inverse(std::complex<double> *data) const;
+
+    static size_t nextPowerOfTwo(size_t n);
+    static const char *backendName();
+
+private:
+    size_t m_size;
+
+#ifdef USE_FFTW3
+    fftw_plan m_forwardPlan;
+    fftw_plan m_inversePlan;
+#else
+    std::vector<std::complex<double>> m_twiddles;
+    std::vector<size_t> m_bitReverse;
+
+    void transform(std::complex<double> *data, bool inverse) const;
+#endif
+};
+
+#endif
@@ -0,0 +1,543 @@
+#include "HeadlessRunner.h"
+
+#include "CSVReader.h"
+#include "CoefficientArchive.h"
+#include "CoefficientSinks.h"
+#include "PerfRecorder.h"
+#include "ScalogramImage.h"
+#include "SignalColumn.h"
+#include "SignalFile.h"
+#include "ThreadPool.h"
+#include "WaveletTransform.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+// Default width of the PNG scalogram; longer ranges are max-pooled to fit
+static const int kDefaultPngWidth = 4096;
+
+struct HeadlessOptions {
+    std::vector<size_t> channels; // 0-based; empty for every channel
+    int waveletType;
+    int engine;
+    double minScale;
+    double maxScale;
+    int scaleSteps;
+    int voicesPerOctave;          // octave grid when positive, scaleSteps linear steps otherwise
+    long long startSample;
+    long long endSample;          // negative for the end of the signal
+    double supportTolerance;
+    int resultType;
+    bool writeCoefficients;
+    bool writeArchive;            // coefficients as a compressed, chunked .mdscwz
+    bool writePower;
+    bool writePng;
+    int pngWidth;
+    int colormap;                 // ScalogramImage::Colormap of the PNG
+    double dynamicRangeDb;        // decibel PNG over this range; 0 for linear |W|
+    QString outputDir;            // empty to write next to each input
+    QString tracePath;            // Chrome trace of the run; empty for none
+    double samplingRate;          // for CSV files without a time column
+    int jobs;
+    int threads;
+};
+
+struct LoadedSignal {
+    std::vector<SignalColumn> channels;
+    double samplingRate;
+    double timeOrigin;
+};
+
+static std::mutex s_printMutex;
+
+// Lines from concurrent files are never interleaved
+static void printLine(FILE *stream, const QString &line)
+{
+    std::lock_guard<std::mutex> lock(s_printMutex);
+    std::fprintf(stream, "%s\n", line.toLocal8Bit().constData());
+    std::fflush(stream);
+}
+
+static int indexOfName(const QString &name, const QStringList &names)
+{
+    return names.indexOf(name.trimmed().toLower());
+}
+
+static bool parseChannels(const QString &text, std::vector<size_t> &channels)
+{
+    channels.clear();
+    if (text.trimmed().toLower() == "all") {
+        return true;
+    }
+    
+    // 1-based numbers and ranges, e.g. "1,3-5"
+    for (const QString &item : text.split(',')) {
+        QStringList bounds = item.split('-');
+        if (bounds.size() > 2) {
+            return false;
+        }
+        bool ok = false;
+        int first = bounds[0].trimmed().toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+        int last = first;
+        if (bounds.size() == 2) {
+            last = bounds[1].trimmed().toInt(&ok);
+            if (!ok) {
+                return false;
+            }
+        }
+        if (first < 1 || last < first) {
+            return false;
+        }
+        for (int channel = first; channel <= last; ++channel) {
+            channels.push_back(static_cast<size_t>(channel - 1));
+        }
+    }
+    return !channels.empty();
+}
+
+static bool parseInteger(const QString &text, int minimum, int &value)
+{
+    bool ok = false;
+    value = text.toInt(&ok);
+    return ok && value >= minimum;
+}
+
+static bool parseOptions(const QCommandLineParser &parser, HeadlessOptions &options, QString &error)
+{
+    static const QStringList wavelets = {"morlet", "mexican-hat", "daubechies"};
+    static const QStringList engines = {"auto", "direct", "fft", "streaming"};
+    static const QStringList resultTypes = {"complex-double", "complex-float", "magnitude", "power"};
+    
+    if (!parseChannels(parser.value("channels"), options.channels)) {
+        error = "Invalid channel list: " + parser.value("channels");
+        return false;
+    }
+    options.waveletType = indexOfName(parser.value("wavelet"), wavelets);
+    if (options.waveletType < 0) {
+        error = "Unknown wavelet: " + parser.value("wavelet");
+        return false;
+    }
+    options.engine = indexOfName(parser.value("engine"), engines);
+    if (options.engine < 0) {
+        error = "Unknown engine: " + parser.value("engine");
+        return false;
+    }
+    options.resultType = indexOfName(parser.value("result-type"), resultTypes);
+    if (options.resultType < 0) {
+        error = "Unknown result type: " + parser.value("result-type");
+        return false;
+    }
+    
+    bool ok = false;
+    bool maxOk = false;
+    options.minScale = parser.value("min-scale").toDouble(&ok);
+    options.maxScale = parser.value("max-scale").toDouble(&maxOk);
+    if (!ok || !maxOk || !(options.minScale > 0.0) || options.maxScale < options.minScale ||
+        !parseInteger(parser.value("scale-steps"), 1, options.scaleSteps) ||
+        !parseInteger(parser.value("voices-per-octave"), 0, options.voicesPerOctave)) {
+        error = "Scales must satisfy 0 < min-scale <= max-scale, scale-steps >= 1 and voices-per-octave >= 0";
+        return false;
+    }
+    
+    options.startSample = parser.value("start").toLongLong(&ok);
+    if (!ok || options.startSample < 0) {
+        error = "Invalid start sample: " + parser.value("start");
+        return false;
+    }
+    options.endSample = -1;
+    if (parser.isSet("end")) {
+        options.endSample = parser.value("end").toLongLong(&ok);
+        if (!ok || options.endSample <= options.startSample) {
+            error = "The end sample must come after the start sample";
+            return false;
+        }
+    }
+    
+    options.supportTolerance = parser.value("tolerance").toDouble(&ok);
+    if (!ok || options.supportTolerance < 0.0 || options.supportTolerance >= 1.0) {
+        error = "Invalid support tolerance: " + parser.value("tolerance");
+        return false;
+    }
+    options.samplingRate = parser.value("sampling-rate").toDouble(&ok);
+    if (!ok || !(options.samplingRate > 0.0)) {
+        error = "Invalid sampling rate: " + parser.value("sampling-rate");
+        return false;
+    }
+    
+    options.writeCoefficients = false;
+    options.writeArchive = false;
+    options.writePower = false;
+    options.writePng = false;
+    for (const QString &output : parser.value("output").split(',')) {
+        const QString kind = output.trimmed().toLower();
+        if (kind == "coefficients") {
+            options.writeCoefficients = true;
+        } else if (kind == "archive") {
+            options.writeArchive = true;
+        } else if (kind == "power") {
+            options.writePower = true;
+        } else if (kind == "png") {
+            options.writePng = true;
+        } else {
+            error = "Unknown output: " + output;
+            return false;
+        }
+    }
+    
+    options.colormap = -1;
+    for (int colormap = 0; colormap < ScalogramImage::kColormapCount; ++colormap) {
+        if (parser.value("colormap").toLower() == ScalogramImage::colormapName(
+                static_cast<ScalogramImage::Colormap>(colormap))) {
+            options.colormap = colormap;
+        }
+    }
+    if (options.colormap < 0) {
+        error = "Unknown colormap: " + parser.value("colormap");
+        return false;
+    }
+    options.dynamicRangeDb = parser.value("db-range").toDouble(&ok);
+    if (!ok || options.dynamicRangeDb < 0.0 || options.dynamicRangeDb > 200.0) {
+        error = "Invalid dB range: " + parser.value("db-range");
+        return false;
+    }
+    
+    if (!parseInteger(parser.value("png-width"), 1, options.pngWidth) ||
+        !parseInteger(parser.value("jobs"), 0, options.jobs) ||
+        !parseInteger(parser.value("threads"), 0, options.threads)) {
+        error = "png-width must be positive, jobs and threads zero or positive";
+        return false;
+    }
+    options.outputDir = parser.value("output-dir");
+    options.tracePath = parser.value("trace");
+    return true;
+}
+
+static bool collectInputs(const QStringList &arguments, std::vector<QString> &files, QString &error)
+{
+    for (const QString &argument : arguments) {
+        QFileInfo info(argument);
+        if (info.isDir()) {
+            // Directory order is not stable across file systems
+            const QFileInfoList entries = QDir(argument).entryInfoList({"*.csv", "*.mdsb"}, QDir::Files, QDir::Name);
+            for (const QFileInfo &entry : entries) {
+                files.push_back(entry.filePath());
+            }
+        } else if (info.isFile()) {
+            files.push_back(argument);
+        } else {
+            error = "No such file or directory: " + argument;
+            return false;
+        }
+    }
+    return true;
+}
+
+static LoadedSignal loadSignal(const QString &path, const HeadlessOptions &options, ThreadPool &pool)
+{
+    const std::string filename = QFile::encodeName(path).constData();
+    LoadedSignal signal;
+    signal.samplingRate = options.samplingRate;
+    signal.timeOrigin = 0.0;
+    
+    // The format is detected from the content, not the extension
+    if (SignalFile::isSignalFile(filename)) {
+        PerfRecorder::Scope scope("load binary");
+        SignalFile::Contents contents = SignalFile::read(filename);
+        signal.channels = std::move(contents.channels);
+        signal.samplingRate = contents.samplingRate;
+        signal.timeOrigin = contents.timeOrigin;
+        scope.setItems(signal.channels.empty() ? 0.0 : static_cast<double>(signal.channels[0].size())
+                                                       * signal.channels.size());
+    } else {
+        PerfRecorder::Scope scope("load CSV");
+        CSVReader::Data data = CSVReader::read(filename, pool);
+        scope.setItems(static_cast<double>(data.samples()) * data.channels.size());
+        for (auto &channel : data.channels) {
+            signal.channels.emplace_back(std::move(channel));
+        }
+        // As in the GUI, a time column sets the rate from its first step
+        if (data.time.size() > 1) {
+            signal.samplingRate = 1.0 / (data.time[1] - data.time[0]);
+            signal.timeOrigin = data.time[0];
+        }
+    }
+    
+    if (signal.channels.empty() || signal.channels[0].empty() || !(signal.samplingRate > 0.0)) {
+        throw std::runtime_error("No signal data");
+    }
+    return signal;
+}
+
+static void transformChannel(const QString &input, const LoadedSignal &signal, size_t channel,
+                             const QString &outputBase, const HeadlessOptions &options,
+                             WaveletTransform &transform)
+{
+    const SignalColumn &column = signal.channels[channel];
+    const size_t start = std::min(static_cast<size_t>(options.startSample), column.size());
+    const size_t end = options.endSample < 0 ? column.size()
+                                             : std::min(static_cast<size_t>(options.endSample), column.size());
+    if (start >= end) {
+        throw std::runtime_error("The sample range is past the end of the signal");
+    }
+    const size_t length = end - start;
+    const double timeOrigin = signal.timeOrigin + start / signal.samplingRate;
+    
+    WaveletTransform::Job job;
+    job.waveletType = options.waveletType;
+    job.supportTolerance = options.supportTolerance;
+    job.scales = options.voicesPerOctave > 0
+        ? WaveletTransform::octaveGrid(options.minScale, options.maxScale, options.voicesPerOctave)
+        : WaveletTransform::scaleGrid(options.minScale, options.maxScale, options.scaleSteps);
+    
+    // Without a coefficient file only power or magnitudes are ever needed,
+    // so the in-memory engines get by with the smallest element type
+    if (options.writeCoefficients || options.writeArchive) {
+        job.resultType = options.resultType;
+    } else if (options.writePower) {
+        job.resultType = CoefficientMatrix::PowerFloat;
+    } else {
+        job.resultType = CoefficientMatrix::MagnitudeFloat;
+    }
+    job.engine = WaveletTransform::resolveEngine(options.engine, length, job.scales.size(), job.resultType);
+    
+    // Every output is a sink, fed tile by tile when streaming and with the
+    // whole matrix otherwise
+    QStringList outputs;
+    std::vector<std::shared_ptr<CoefficientSink>> sinks;
+    if (options.writeCoefficients) {
+        const QString path = outputBase + ".mdscwt";
+        sinks.push_back(std::make_shared<CoefficientFileSink>(QFile::encodeName(path).constData(),
+                                                              signal.samplingRate, timeOrigin));
+        outputs << path;
+    }
+    if (options.writeArchive) {
+        const QString path = outputBase + ".mdscwz";
+        sinks.push_back(std::make_shared<CoefficientArchiveSink>(QFile::encodeName(path).constData(),
+                                                                 signal.samplingRate, timeOrigin));
+        outputs << path;
+    }
+    if (options.writePower) {
+        const QString path = outputBase + "_power.mdscwt";
+        auto file = std::make_shared<CoefficientFileSink>(QFile::encodeName(path).constData(),
+                                                          signal.samplingRate, timeOrigin);
+        if (job.resultType == CoefficientMatrix::PowerFloat) {
+            sinks.push_back(file);
+        } else {
+            sinks.push_back(std::make_shared<PowerConversionSink>(file));
+        }
+        outputs << path;
+    }
+    std::shared_ptr<ScalogramOverviewSink> overview;
+    if (options.writePng) {
+        overview = std::make_shared<ScalogramOverviewSink>(options.pngWidth);
+        sinks.push_back(overview);
+    }
+    
+    const auto started = std::chrono::steady_clock::now();
+    if (job.engine == WaveletTransform::EngineStreaming) {
+        job.source = column;
+        job.sourceBegin = start;
+        job.sourceEnd = end;
+        job.sinks = sinks;
+        transform.compute(job);
+    } else {
+        job.signal.resize(length);
+        column.copy(start, end, job.signal.data());
+        transform.compute(job);
+        
+        for (const auto &sink : sinks) {
+            sink->begin(job.scales, length);
+        }
+        for (const auto &sink : sinks) {
+            sink->consumeTile(*job.coefficients, 0, length);
+        }
+        for (const auto &sink : sinks) {
+            sink->finish();
+        }
+    }
+    
+    if (overview) {
+        const QString path = outputBase + ".png";
+        const QImage image = ScalogramImage::render(*overview->overview(),
+                                                    static_cast<ScalogramImage::Colormap>(options.colormap),
+                                                    options.dynamicRangeDb > 0.0 ? ScalogramImage::Decibel
+                                                                                 : ScalogramImage::Linear,
+                                                    options.dynamicRangeDb, &transform.threadPool());
+        if (!image.save(path, "PNG")) {
+            throw std::runtime_error("Cannot write " + std::string(QFile::encodeName(path).constData()));
+        }
+        outputs << path;
+    }
+    const double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    
+    printLine(stdout, QString("%1 channel %2: %3 scales x %4 samples, %5, %6 ms -> %7")
+                      .arg(input)
+                      .arg(channel + 1)
+                      .arg(job.scales.size())
+                      .arg(length)
+                      .arg(QString::fromStdString(WaveletTransform::engineName(job.engine)))
+                      .arg(elapsedMs, 0, 'f', 1)
+                      .arg(outputs.join(", ")));
+}
+
+static bool processFile(const QString &path, const HeadlessOptions &options, WaveletTransform &transform)
+{
+    try {
+        const LoadedSignal signal = loadSignal(path, options, transform.threadPool());
+        
+        std::vector<size_t> channels = options.channels;
+        if (channels.empty()) {
+            for (size_t channel = 0; channel < signal.channels.size(); ++channel) {
+                channels.push_back(channel);
+            }
+        }
+        for (size_t channel : channels) {
+            if (channel >= signal.channels.size()) {
+                throw std::runtime_error("No channel " + std::to_string(channel + 1) + " (the file has "
+                                         + std::to_string(signal.channels.size()) + ")");
+            }
+        }
+        
+        const QFileInfo info(path);
+        const QString directory = options.outputDir.isEmpty() ? info.absolutePath() : options.outputDir;
+        for (size_t channel : channels) {
+            const QString outputBase = QString("%1/%2_ch%3").arg(directory).arg(info.completeBaseName()).arg(channel + 1);
+            transformChannel(path, signal, channel, outputBase, options, transform);
+        }
+    } catch (const std::exception &e) {
+        printLine(stderr, QString("%1: %2").arg(path).arg(QString::fromLocal8Bit(e.what())));
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessRunner::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HeadlessRunner::run(const QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Continuous wavelet transform of signal files, without a window.\n"
+                                     "Writes <name>_ch<N>.mdscwt, <name>_ch<N>_power.mdscwt and/or "
+                                     "<name>_ch<N>.png per file and channel.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("inputs", "Signal files (.csv, .mdsb), or directories whose .csv and "
+                                           ".mdsb files are all processed.", "<file or directory>...");
+    parser.addOption(QCommandLineOption("headless", "Run without a window."));
+    parser.addOption(QCommandLineOption({"c", "channels"}, "Channels, 1-based: a list such as 1,3-5, or all.",
+                                        "list", "1"));
+    parser.addOption(QCommandLineOption({"w", "wavelet"}, "morlet, mexican-hat or daubechies.", "name", "morlet"));
+    parser.addOption(QCommandLineOption("min-scale", "Smallest scale, may be fractional.", "scale", "1"));
+    parser.addOption(QCommandLineOption("max-scale", "Largest scale.", "scale", "64"));
+    parser.addOption(QCommandLineOption("scale-steps", "Number of evenly spaced scales.", "n", "64"));
+    parser.addOption(QCommandLineOption("voices-per-octave", "Geometric scale grid with n scales per "
+                                        "doubling instead of scale-steps (0: off).", "n", "0"));
+    parser.addOption(QCommandLineOption("start", "First sample of the analysed range.", "sample", "0"));
+    parser.addOption(QCommandLineOption("end", "Sample after the analysed range (default: the end).", "sample"));
+    parser.addOption(QCommandLineOption({"e", "engine"}, "auto, direct, fft or streaming.", "name", "auto"));
+    parser.addOption(QCommandLineOption("tolerance", "Fraction of wavelet energy the kernels may drop.",
+                                        "fraction", "1e-9"));
+    parser.addOption(QCommandLineOption({"r", "result-type"}, "Coefficient file elements: complex-double, "
+                                        "complex-float, magnitude or power.", "type", "complex-double"));
+    parser.addOption(QCommandLineOption({"o", "output"}, "What to write: coefficients, archive (compressed "
+                                        "coefficients), power and/or png, comma-separated.", "kinds", "coefficients"));
+    parser.addOption(QCommandLineOption({"d", "output-dir"}, "Directory for the results (default: next to "
+                                        "each input).", "dir"));
+    parser.addOption(QCommandLineOption("png-width", "Widest PNG scalogram; longer ranges keep each "
+                                        "column's peak.", "pixels", QString::number(kDefaultPngWidth)));
+    parser.addOption(QCommandLineOption("colormap", "PNG colours: rainbow, viridis, inferno or gray.", "name",
+                                        "rainbow"));
+    parser.addOption(QCommandLineOption("db-range", "PNG in decibels relative to the largest |W|, down to "
+                                        "-range (0: linear |W|).", "dB", "0"));
+    parser.addOption(QCommandLineOption("sampling-rate", "Sampling rate of CSV files without a time column.",
+                                        "Hz", "1000"));
+    parser.addOption(QCommandLineOption("trace", "Write a Chrome trace (chrome://tracing, Perfetto) of "
+                                        "loading, transforms and rendering to this file.", "file"));
+    parser.addOption(QCommandLineOption({"j", "jobs"}, "Files processed at once (0: one per hardware "
+                                        "thread).", "n", "0"));
+    parser.addOption(QCommandLineOption("threads", "Worker threads per file (0: hardware threads / jobs).",
+                                        "n", "0"));
+    parser.process(app);
+    
+    HeadlessOptions options;
+    QString error;
+    std::vector<QString> files;
+    if (!parseOptions(parser, options, error) || !collectInputs(parser.positionalArguments(), files, error)) {
+        printLine(stderr, "mdsv2: " + error);
+        return 2;
+    }
+    if (files.empty()) {
+        printLine(stderr, "mdsv2: no input files");
+        return 2;
+    }
+    if (!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)) {
+        printLine(stderr, "mdsv2: cannot create " + options.outputDir);
+        return 1;
+    }
+    
+    // Files are independent, so several run at once, each on its own
+    // transform with a share of the cores. The kernel tables are shared:
+    // files with the same parameters build each table only once.
+    const size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t jobs = std::min(options.jobs > 0 ? static_cast<size_t>(options.jobs) : hardwareThreads,
+                                 files.size());
+    const size_t threads = options.threads > 0 ? static_cast<size_t>(options.threads)
+                                               : std::max<size_t>(1, hardwareThreads / jobs);
+    auto cache = std::make_shared<WaveletKernelCache>();
+    std::atomic<size_t> nextFile(0);
+    std::atomic<size_t> failures(0);
+    
+    auto worker = [&]() {
+        WaveletTransform transform(threads, cache);
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            if (!processFile(files[i], options, transform)) {
+                ++failures;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    
+    if (!options.tracePath.isEmpty()) {
+        try {
+            PerfRecorder::instance().writeChromeTrace(QFile::encodeName(options.tracePath).constData());
+        } catch (const std::exception &e) {
+            printLine(stderr, QString("mdsv2: %1").arg(e.what()));
+            return 1;
+        }
+    }
+    
+    return failures ? 1 : 0;
+}
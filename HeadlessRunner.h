@@ -0,0 +1,26 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+class QCoreApplication;
+
+
+// Command-line analysis without any window, for batch runs on machines
+// without a display:
+//
+//   mdsv2 --headless [options] <file or directory>...
+//
+// Every input file (.csv or .mdsb, or every such file in a directory) is
+// transformed with the same engines as the GUI, and the coefficients,
+// their power or a PNG scalogram are written per channel. Several files
+// are processed at once; see --help for the options.
+class HeadlessRunner
+{
+public:
+    // True if the command line asks for headless mode
+    static bool requested(int argc, char *argv[]);
+    
+    // Parses app's arguments and runs the batch; returns the exit code
+    static int run(const QCoreApplication &app);
+};
+
+#endif
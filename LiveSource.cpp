@@ -0,0 +1,262 @@
+#include "LiveSource.h"
+
+#include "CSVReader.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+// How long the reader waits for data before it checks for a stop request
+static const int kPollTimeoutMs = 50;
+
+static long long steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool isSeparator(char c)
+{
+    return c == ';' || c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+LiveSource::LiveSource(const std::string &endpoint, size_t capacityFrames)
+    : m_endpoint(endpoint)
+    , m_capacity(capacityFrames)
+    , m_channelCount(0)
+    , m_lastArrivalNs(0)
+    , m_malformedLines(0)
+    , m_stop(false)
+    , m_finished(false)
+{
+    m_thread = std::thread(&LiveSource::run, this);
+}
+
+LiveSource::~LiveSource()
+{
+    m_stop = true;
+    m_thread.join();
+}
+
+SampleRingBuffer *LiveSource::buffer() const
+{
+    // The channel count is published after the buffer was created
+    return channelCount() ? m_buffer.get() : nullptr;
+}
+
+std::string LiveSource::error() const
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_error;
+}
+
+void LiveSource::parseLine(const char *begin, const char *end)
+{
+    m_frame.clear();
+    const char *field = begin;
+    while (true) {
+        while (field < end && isSeparator(*field)) {
+            ++field;
+        }
+        if (field == end) {
+            break;
+        }
+        const char *fieldEnd = field;
+        while (fieldEnd < end && !isSeparator(*fieldEnd)) {
+            ++fieldEnd;
+        }
+        
+        double value;
+        if (!CSVReader::parseNumber(field, fieldEnd, value)) {
+            m_malformedLines.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_frame.push_back(value);
+        field = fieldEnd;
+    }
+    
+    if (m_frame.empty()) {
+        return;
+    }
+    if (!m_buffer) {
+        m_buffer.reset(new SampleRingBuffer(m_frame.size(), m_capacity));
+        m_channelCount.store(m_frame.size(), std::memory_order_release);
+    }
+    if (m_frame.size() != m_buffer->channels()) {
+        m_malformedLines.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_buffer->push(m_frame.data());
+}
+
+#ifdef _WIN32
+
+int LiveSource::connect()
+{
+    throw std::runtime_error("Live sources are not supported on this platform");
+}
+
+void LiveSource::run()
+{
+    try {
+        connect();
+    } catch (const std::exception &e) {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_error = e.what();
+    }
+    m_finished = true;
+}
+
+#else
+
+int LiveSource::connect()
+{
+    if (m_endpoint == "-") {
+        return STDIN_FILENO;
+    }
+    
+    if (m_endpoint.compare(0, 6, "tcp://") == 0) {
+        std::string address = m_endpoint.substr(6);
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::runtime_error("Expected tcp://host:port, got " + m_endpoint);
+        }
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+        
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+        if (status != 0) {
+            throw std::runtime_error("Cannot resolve " + address + ": " + gai_strerror(status));
+        }
+        
+        int fd = -1;
+        for (addrinfo *candidate = addresses; candidate && fd < 0; candidate = candidate->ai_next) {
+            fd = ::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+            if (fd >= 0 && ::connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot connect to " + address + ": " + std::strerror(errno));
+        }
+        return fd;
+    }
+    
+    if (m_endpoint.compare(0, 5, "unix:") == 0) {
+        std::string path = m_endpoint.substr(5);
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Invalid Unix socket path " + path);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size());
+        
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            int savedErrno = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Cannot connect to " + path + ": " + std::strerror(savedErrno));
+        }
+        return fd;
+    }
+    
+    // Non-blocking, so opening a FIFO does not wait for its writer and a
+    // stop request is never stuck in open()
+    int fd = ::open(m_endpoint.c_str(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + m_endpoint + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+void LiveSource::run()
+{
+    int fd = -1;
+    try {
+        fd = connect();
+        struct stat info;
+        const bool isFifo = fd != STDIN_FILENO && ::fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+        
+        std::string pending;
+        std::vector<char> chunk(size_t(1) << 16);
+        bool receivedData = false;
+        
+        while (!m_stop) {
+            pollfd request;
+            request.fd = fd;
+            request.events = POLLIN;
+            request.revents = 0;
+            int ready = ::poll(&request, 1, kPollTimeoutMs);
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error(std::string("Reading live source failed: ") + std::strerror(errno));
+            }
+            if (ready <= 0) {
+                continue;
+            }
+            
+            ssize_t count = ::read(fd, chunk.data(), chunk.size());
+            if (count < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Reading live source failed: ") + std::strerror(errno));
+            }
+            if (count == 0) {
+                // A FIFO reads as empty until its writer has connected
+                if (!receivedData && isFifo) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(kPollTimeoutMs));
+                    continue;
+                }
+                break;
+            }
+            receivedData = true;
+            const long long arrival = steadyNowNs();
+            
+            pending.append(chunk.data(), static_cast<size_t>(count));
+            size_t lineStart = 0;
+            while (true) {
+                size_t lineEnd = pending.find('\n', lineStart);
+                if (lineEnd == std::string::npos) {
+                    break;
+                }
+                parseLine(pending.data() + lineStart, pending.data() + lineEnd);
+                lineStart = lineEnd + 1;
+            }
+            pending.erase(0, lineStart);
+            
+            m_lastArrivalNs.store(arrival, std::memory_order_release);
+        }
+    } catch (const std::exception &e) {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_error = e.what();
+    }
+    
+    if (fd > STDIN_FILENO) {
+        ::close(fd);
+    }
+    m_finished = true;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LIVESOURCE_H
+#define LIVESOURCE_H
+
+#include "SampleRingBuffer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Reads a live signal on a background thread into a SampleRingBuffer.
+// The stream is text, one frame per line: the channel values separated
+// by ';', ',' or blanks, without a time column. The first numeric line
+// fixes the channel count; lines that do not parse or have a different
+// count are skipped and counted. Endpoints:
+//
+//   -                 standard input
+//   tcp://host:port   TCP connection to a local generator
+//   unix:/path        Unix domain stream socket
+//   anything else     a named pipe (or any readable file)
+//
+// Connecting happens on the reader thread, so the constructor never
+// blocks; failures show up through finished() and error().
+class LiveSource
+{
+public:
+    explicit LiveSource(const std::string &endpoint, size_t capacityFrames = size_t(1) << 16);
+    ~LiveSource();
+    
+    LiveSource(const LiveSource &) = delete;
+    LiveSource &operator=(const LiveSource &) = delete;
+    
+    const std::string &endpoint() const { return m_endpoint; }
+    
+    // 0, and buffer() null, until the first frame has been parsed
+    size_t channelCount() const { return m_channelCount.load(std::memory_order_acquire); }
+    SampleRingBuffer *buffer() const;
+    
+    // steady_clock time, in nanoseconds, at which the newest frame arrived
+    long long lastArrivalNs() const { return m_lastArrivalNs.load(std::memory_order_acquire); }
+    
+    size_t malformedLines() const { return m_malformedLines.load(std::memory_order_relaxed); }
+    
+    // True once the stream ended or failed; error() is empty on a clean end
+    bool finished() const { return m_finished.load(std::memory_order_acquire); }
+    std::string error() const;
+
+private:
+    void run();
+    int connect();
+    void parseLine(const char *begin, const char *end);
+    
+    std::string m_endpoint;
+    size_t m_capacity;
+    std::unique_ptr<SampleRingBuffer> m_buffer;
+    std::atomic<size_t> m_channelCount;
+    std::atomic<long long> m_lastArrivalNs;
+    std::atomic<size_t> m_malformedLines;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_finished;
+    
+    mutable std::mutex m_errorMutex;
+    std::string m_error;
+    
+    std::vector<double> m_frame;
+    std::thread m_thread;
+};
+
+#endif
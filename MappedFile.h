@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+
+// Read-only memory mapping of a whole file. The mapping stays valid for
+// the lifetime of the object; throws std::runtime_error if the file
+// cannot be opened or mapped.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    
+    // Tells the OS the mapping will be read front to back
+    void adviseSequential() const;
+
+private:
+    const char *m_data;
+    size_t m_size;
+    
+#ifdef _WIN32
+    void *m_file;
+    void *m_mapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "PerfRecorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+PerfRecorder &PerfRecorder::instance()
+{
+    static PerfRecorder recorder;
+    return recorder;
+}
+
+PerfRecorder::PerfRecorder()
+    : m_nextEvent(0)
+    , m_originNs(nowNs())
+{
+}
+
+PerfRecorder::Scope::Scope(const char *name, double items)
+    : m_recorder(instance())
+    , m_name(name)
+    , m_items(items)
+    , m_startNs(nowNs())
+{
+}
+
+PerfRecorder::Scope::~Scope()
+{
+    m_recorder.record(m_name, m_startNs, nowNs() - m_startNs, m_items);
+}
+
+int64_t PerfRecorder::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t PerfRecorder::peakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+uint32_t PerfRecorder::threadIndex()
+{
+    // Small stable numbers read better in a trace viewer than thread ids
+    static std::atomic<uint32_t> nextIndex(1);
+    thread_local const uint32_t index = nextIndex++;
+    return index;
+}
+
+void PerfRecorder::record(const char *name, int64_t startNs, int64_t durationNs, double items)
+{
+    const uint32_t thread = threadIndex();
+    const double ms = durationNs / 1e6;
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = 0;
+    while (index < m_names.size() && m_names[index] != name && std::strcmp(m_names[index], name) != 0) {
+        ++index;
+    }
+    if (index == m_names.size()) {
+        m_names.push_back(name);
+        m_stats.push_back(Stat{name, 0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    }
+    Stat &stat = m_stats[index];
+    ++stat.count;
+    stat.totalMs += ms;
+    stat.lastMs = ms;
+    stat.maxMs = std::max(stat.maxMs, ms);
+    stat.items += items;
+    stat.lastItems = items;
+    
+    const Event event = {name, startNs, durationNs, items, thread};
+    if (m_events.size() < kMaxEvents) {
+        m_events.push_back(event);
+    } else {
+        m_events[m_nextEvent] = event;
+        m_nextEvent = (m_nextEvent + 1) % kMaxEvents;
+    }
+}
+
+std::vector<PerfRecorder::Stat> PerfRecorder::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+size_t PerfRecorder::eventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events.size();
+}
+
+void PerfRecorder::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_names.clear();
+    m_stats.clear();
+    m_events.clear();
+    m_nextEvent = 0;
+    m_originNs = nowNs();
+}
+
+void PerfRecorder::writeChromeTrace(const std::string &path) const
+{
+    std::vector<Event> events;
+    int64_t originNs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        events.assign(m_events.begin() + m_nextEvent, m_events.end());
+        events.insert(events.end(), m_events.begin(), m_events.begin() + m_nextEvent);
+        originNs = m_originNs;
+    }
+    
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    
+    // Complete ("X") events in microseconds; the names are literals
+    // without quotes or backslashes, so they need no escaping
+    out.precision(15);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event &event = events[i];
+        out << (i ? ",\n" : "\n")
+            << "{\"name\":\"" << event.name << "\",\"cat\":\"mdsv2\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << (event.startNs - originNs) / 1e3 << ",\"dur\":" << event.durationNs / 1e3
+            << ",\"args\":{\"items\":" << event.items << "}}";
+    }
+    out << "\n]}\n";
+    
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef PERFRECORDER_H
+#define PERFRECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Process-wide record of timed hot-path steps: loading, transforms,
+// scalogram rendering and painting. Keeps totals per step for a stats
+// panel and the most recent events for a Chrome trace (chrome://tracing,
+// Perfetto), so a slow machine can be diagnosed without a profiler. Meant
+// for coarse steps: a scope costs two clock reads and a short lock.
+class PerfRecorder
+{
+public:
+    struct Stat {
+        std::string name;
+        size_t count;
+        double totalMs;
+        double lastMs;
+        double maxMs;
+        double items;            // work units reported by all scopes, e.g. samples x scales
+        double lastItems;
+    };
+    
+    // Events kept for the trace; older ones are overwritten
+    static const size_t kMaxEvents = 100000;
+    
+    static PerfRecorder &instance();
+    
+    PerfRecorder(const PerfRecorder &) = delete;
+    PerfRecorder &operator=(const PerfRecorder &) = delete;
+    
+    // Times its own lifetime under name, which must outlive the recorder
+    // (a string literal). items is the work done, for the throughput.
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name, double items = 0.0);
+        ~Scope();
+        
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        
+        void setItems(double items) { m_items = items; }
+    
+    private:
+        PerfRecorder &m_recorder;    // created first, so the trace starts before the scope
+        const char *m_name;
+        double m_items;
+        int64_t m_startNs;
+    };
+    
+    void record(const char *name, int64_t startNs, int64_t durationNs, double items);
+    
+    // One entry per step name, in order of first appearance
+    std::vector<Stat> stats() const;
+    size_t eventCount() const;
+    void reset();
+    
+    // Writes the kept events as Chrome trace JSON; throws
+    // std::runtime_error if the file cannot be written
+    void writeChromeTrace(const std::string &path) const;
+    
+    // Monotonic clock of the events
+    static int64_t nowNs();
+    // Largest resident set of the process so far, 0 where unknown
+    static size_t peakResidentBytes();
+
+private:
+    PerfRecorder();
+    
+    struct Event {
+        const char *name;
+        int64_t startNs;
+        int64_t durationNs;
+        double items;
+        uint32_t thread;
+    };
+    
+    static uint32_t threadIndex();
+    
+    mutable std::mutex m_mutex;
+    std::vector<const char *> m_names;   // m_stats[i] is the step named m_names[i]
+    std::vector<Stat> m_stats;
+    std::vector<Event> m_events;
+    size_t m_nextEvent;                  // slot the next event overwrites once m_events is full
+    int64_t m_originNs;
+};
+
+#endif
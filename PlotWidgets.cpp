@@ -1,9 +1,14 @@
 #include "WaveletAnalyzer.h"
+#include "PerfRecorder.h"
+#include "ScalogramImage.h"
 #include <QPainter>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QContextMenuEvent>
+#include <QMenu>
 #include <QtMath>
 #include <algorithm>
+#include <cstring>
 
 
 SignalPlotWidget::SignalPlotWidget(QWidget *parent)
@@ -11,17 +16,25 @@ SignalPlotWidget::SignalPlotWidget(QWidget *parent)
     , m_startIndex(0)
     , m_endIndex(1000)
     , m_zoomFactor(1.0)
+    , m_rangeMin(0.0)
+    , m_rangeMax(0.0)
 {
     setMinimumHeight(200);
     setMouseTracking(true);
     setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
-void SignalPlotWidget::setSignalData(const std::vector<double> &signal, const std::vector<double> &time)
+void SignalPlotWidget::setSignalData(const SignalColumn &signal, const SignalColumn &time)
 {
+    // The analyzer hands the same column over on every range change; only
+    // new samples need a new summary
+    if (!signal.sharesStorage(m_envelope.signal())) {
+        m_envelope.build(signal);
+    }
     m_signal = signal;
     m_time = time;
     m_endIndex = std::min(static_cast<int>(signal.size()), 1000);
+    updateRangeExtrema();
     update();
 }
 
@@ -32,11 +45,24 @@ void SignalPlotWidget::setTimeRange(int start, int end)
     if (m_startIndex >= m_endIndex) {
         m_endIndex = m_startIndex + 1;
     }
+    updateRangeExtrema();
     update();
 }
 
+void SignalPlotWidget::updateRangeExtrema()
+{
+    m_rangeMin = 0.0;
+    m_rangeMax = 0.0;
+    if (m_startIndex < m_endIndex && m_endIndex <= static_cast<int>(m_signal.size())) {
+        auto minMax = m_envelope.minMax(m_startIndex, m_endIndex);
+        m_rangeMin = minMax.first;
+        m_rangeMax = minMax.second;
+    }
+}
+
 void SignalPlotWidget::paintEvent(QPaintEvent *event)
 {
+    PerfRecorder::Scope scope("signal paint");
     QPainter painter(this);
     painter.fillRect(rect(), Qt::white);
     
@@ -89,7 +115,7 @@ void SignalPlotWidget::drawAxes(QPainter &painter)
     painter.setFont(QFont("Arial", 10));
     
     if (m_startIndex < m_time.size() && m_endIndex <= m_time.size()) {
-        
+    
         for (int i = 0; i <= 5; ++i) {
             int x = plotArea.left() + i * plotArea.width() / 5;
             int timeIdx = m_startIndex + i * (m_endIndex - m_startIndex) / 5;
@@ -101,10 +127,8 @@ void SignalPlotWidget::drawAxes(QPainter &painter)
         }
         
         
-        auto minMax = std::minmax_element(m_signal.begin() + m_startIndex, 
-                                         m_signal.begin() + m_endIndex);
-        double minVal = *minMax.first;
-        double maxVal = *minMax.second;
+        double minVal = m_rangeMin;
+        double maxVal = m_rangeMax;
         double range = maxVal - minVal;
         
         for (int i = 0; i <= 5; ++i) {
@@ -135,14 +159,8 @@ void SignalPlotWidget::drawSignal(QPainter &painter)
     const int margin = 50;
     const QRect plotArea(margin, margin, width() - 2 * margin, height() - 2 * margin);
     
-    painter.setPen(QPen(Qt::blue, 2));
-    painter.setRenderHint(QPainter::Antialiasing);
-    
-    
-    auto minMax = std::minmax_element(m_signal.begin() + m_startIndex, 
-                                     m_signal.begin() + m_endIndex);
-    double minVal = *minMax.first;
-    double maxVal = *minMax.second;
+    double minVal = m_rangeMin;
+    double maxVal = m_rangeMax;
     double range = maxVal - minVal;
     
     if (range < 1e-10) {
@@ -152,6 +170,32 @@ void SignalPlotWidget::drawSignal(QPainter &painter)
     QPolygonF points;
     int numSamples = m_endIndex - m_startIndex;
     
+    // More than two samples per pixel: one vertical min/max stroke per
+    // pixel column, read from the envelope, instead of a point per sample
+    const int pixels = std::max(1, plotArea.width());
+    if (numSamples > 2 * pixels) {
+        std::vector<double> minima(pixels);
+        std::vector<double> maxima(pixels);
+        const double samplesPerPixel = static_cast<double>(numSamples) / pixels;
+        const size_t filled = m_envelope.envelope(m_startIndex, samplesPerPixel, pixels,
+                                                  minima.data(), maxima.data());
+        
+        // Alternating the stroke direction keeps the outline connected
+        points.reserve(2 * static_cast<int>(filled));
+        for (size_t x = 0; x < filled; ++x) {
+            const double px = plotArea.left() + x + 0.5;
+            const double low = plotArea.bottom() - (minima[x] - minVal) / range * plotArea.height();
+            const double high = plotArea.bottom() - (maxima[x] - minVal) / range * plotArea.height();
+            points << QPointF(px, x % 2 ? high : low) << QPointF(px, x % 2 ? low : high);
+        }
+        painter.setPen(QPen(Qt::blue, 1));
+        painter.drawPolyline(points);
+        return;
+    }
+    
+    painter.setPen(QPen(Qt::blue, 2));
+    painter.setRenderHint(QPainter::Antialiasing);
+    
     for (int i = 0; i < numSamples; ++i) {
         int signalIdx = m_startIndex + i;
         if (signalIdx < m_signal.size()) {
@@ -187,119 +231,273 @@ void SignalPlotWidget::wheelEvent(QWheelEvent *event)
 
 ScalogramWidget::ScalogramWidget(QWidget *parent)
     : QWidget(parent)
+    , m_pooling(ScalogramPyramid::Peak)
+    , m_viewDirty(true)
+    , m_viewFirstColumn(0.0)
+    , m_viewColumns(0.0)
+    , m_panning(false)
+    , m_colormap(ScalogramImage::Rainbow)
+    , m_scaling(ScalogramImage::Linear)
+    , m_maxMagnitude(1.0)
+    , m_live(false)
+    , m_liveFirstColumn(0)
+    , m_secondsPerColumn(0.0)
 {
     setMinimumHeight(300);
     setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
-void ScalogramWidget::setCWTData(const std::vector<std::vector<std::complex<double>>> &coefficients,
+void ScalogramWidget::setCWTData(const std::shared_ptr<const CoefficientMatrix> &coefficients,
                                  const std::vector<double> &scales,
                                  const std::vector<double> &time)
 {
-    m_coefficients = coefficients;
+    // A result of the same length keeps the zoom, so a re-run with other
+    // parameters can be compared in place
+    if (time.size() != m_time.size() || m_live) {
+        m_viewColumns = 0.0;
+    }
+    m_live = false;
+    m_scalogramImage = QImage();
     m_scales = scales;
     m_time = time;
     
-    if (!coefficients.empty()) {
-        generateScalogramImage();
+    if (coefficients && !coefficients->empty()) {
+        PerfRecorder::Scope scope("scalogram pyramid", static_cast<double>(coefficients->rows())
+                                                       * coefficients->columns());
+        m_pyramid.build(coefficients);
+    } else {
+        m_pyramid.reset(0, 0);
     }
+    m_viewDirty = true;
     
     update();
 }
 
-void ScalogramWidget::generateScalogramImage()
+void ScalogramWidget::beginCWTData(const std::vector<double> &scales, const std::vector<double> &time)
 {
-    if (m_coefficients.empty() || m_scales.empty() || m_time.empty()) {
+    if (time.size() != m_time.size() || m_live) {
+        m_viewColumns = 0.0;
+    }
+    m_live = false;
+    m_scalogramImage = QImage();
+    m_scales = scales;
+    m_time = time;
+    
+    m_pyramid.reset(m_time.empty() ? 0 : m_scales.size(), m_time.size());
+    m_viewDirty = true;
+    
+    update();
+}
+
+void ScalogramWidget::setCWTRow(const std::shared_ptr<const CoefficientMatrix> &coefficients, size_t scaleIdx)
+{
+    if (!coefficients || m_live || scaleIdx >= m_pyramid.rows() || scaleIdx >= coefficients->rows() ||
+        coefficients->columns() != m_time.size()) {
         return;
     }
     
-    int timeSteps = m_coefficients[0].size();
-    int scaleSteps = m_coefficients.size();
+    m_pyramid.addRow(coefficients, scaleIdx);
+    
+    // A new maximum changes the normalization of every row drawn so far
+    if (updatePalette(m_pyramid.maxMagnitude()) || m_viewImage.height() != static_cast<int>(m_pyramid.rows())) {
+        m_viewDirty = true;
+    } else if (!m_viewDirty) {
+        renderViewRow(scaleIdx);
+    }
+    
+    update();
+}
+
+void ScalogramWidget::beginLiveData(const std::vector<double> &scales, size_t columns, double secondsPerColumn)
+{
+    m_pyramid.reset(0, 0);
+    m_viewImage = QImage();
+    m_scales = scales;
+    m_maxMagnitude = 0.0;
+    m_live = true;
+    m_liveFirstColumn = 0;
+    m_secondsPerColumn = secondsPerColumn;
+    
+    m_time.resize(columns);
+    for (size_t i = 0; i < columns; ++i) {
+        m_time[i] = i * secondsPerColumn;
+    }
     
-    m_scalogramImage = QImage(timeSteps, scaleSteps, QImage::Format_RGB32);
+    if (m_scales.empty() || m_time.empty()) {
+        m_scalogramImage = QImage();
+    } else {
+        m_scalogramImage = QImage(m_time.size(), m_scales.size(), QImage::Format_RGB32);
+        m_scalogramImage.fill(QColor(230, 230, 230));
+    }
     
+    update();
+}
+
+void ScalogramWidget::setLiveColumns(size_t firstColumn, size_t count, const float *magnitudes)
+{
+    if (!m_live || m_scalogramImage.isNull() || count == 0) {
+        return;
+    }
     
-    double maxMagnitude = 0.0;
-    for (const auto &scaleCoeffs : m_coefficients) {
-        for (const auto &coeff : scaleCoeffs) {
-            maxMagnitude = std::max(maxMagnitude, std::abs(coeff));
+    const size_t width = m_scalogramImage.width();
+    const int height = m_scalogramImage.height();
+    
+    // Scroll the image instead of redrawing it: the newest column always
+    // lands on the right edge
+    const size_t lastColumn = firstColumn + count - 1;
+    if (lastColumn >= m_liveFirstColumn + width) {
+        const size_t shift = lastColumn + 1 - width - m_liveFirstColumn;
+        const size_t kept = shift < width ? width - shift : 0;
+        const QRgb background = QColor(230, 230, 230).rgb();
+        for (int y = 0; y < height; ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(m_scalogramImage.scanLine(y));
+            std::memmove(line, line + (width - kept), kept * sizeof(QRgb));
+            std::fill(line + kept, line + width, background);
+        }
+        
+        m_liveFirstColumn += shift;
+        for (size_t i = 0; i < width; ++i) {
+            m_time[i] = (m_liveFirstColumn + i) * m_secondsPerColumn;
         }
     }
     
-    if (maxMagnitude < 1e-10) {
-        maxMagnitude = 1.0;
+    // Colours follow the running peak; columns already drawn keep theirs
+    const size_t rows = std::min<size_t>(m_scales.size(), height);
+    for (size_t i = 0; i < rows * count; ++i) {
+        m_maxMagnitude = std::max(m_maxMagnitude, static_cast<double>(magnitudes[i]));
+    }
+    updatePalette(m_maxMagnitude);
+    
+    // Columns that already scrolled out are skipped
+    const size_t skipped = firstColumn < m_liveFirstColumn ? std::min(count, m_liveFirstColumn - firstColumn) : 0;
+    for (size_t scaleIdx = 0; scaleIdx < rows; ++scaleIdx) {
+        QRgb *line = reinterpret_cast<QRgb *>(m_scalogramImage.scanLine(height - 1 - static_cast<int>(scaleIdx)));
+        m_palette.colorize(magnitudes + scaleIdx * count + skipped, count - skipped,
+                           line + (firstColumn + skipped - m_liveFirstColumn));
     }
     
+    update();
+}
+
+QRect ScalogramWidget::plotArea() const
+{
+    const int margin = 50;
+    return QRect(margin, margin, std::max(1, width() - 100), std::max(1, height() - 2 * margin));
+}
+
+void ScalogramWidget::resetZoom()
+{
+    m_viewFirstColumn = 0.0;
+    m_viewColumns = 0.0;
+    m_viewDirty = true;
+    update();
+}
+
+void ScalogramWidget::clampView()
+{
+    const double columns = static_cast<double>(m_pyramid.columns());
+    if (m_viewColumns <= 0.0 || m_viewColumns > columns) {
+        m_viewColumns = columns;
+    }
+    m_viewFirstColumn = std::min(std::max(m_viewFirstColumn, 0.0), columns - m_viewColumns);
+}
+
+void ScalogramWidget::renderView(int width)
+{
+    const int rows = static_cast<int>(m_pyramid.rows());
+    if (rows == 0 || width <= 0) {
+        m_viewImage = QImage();
+        return;
+    }
+    if (m_viewImage.width() != width || m_viewImage.height() != rows) {
+        m_viewImage = QImage(width, rows, QImage::Format_RGB32);
+    }
     
-    for (int scaleIdx = 0; scaleIdx < scaleSteps; ++scaleIdx) {
-        for (int timeIdx = 0; timeIdx < timeSteps; ++timeIdx) {
-            double magnitude = std::abs(m_coefficients[scaleIdx][timeIdx]);
-            QColor color = valueToColor(magnitude, maxMagnitude);
-            
-            
-            m_scalogramImage.setPixelColor(timeIdx, scaleSteps - 1 - scaleIdx, color);
-        }
+    PerfRecorder::Scope scope("scalogram colorize", static_cast<double>(rows) * width);
+    clampView();
+    updatePalette(m_pyramid.maxMagnitude());
+    for (size_t scaleIdx = 0; scaleIdx < m_pyramid.rows(); ++scaleIdx) {
+        renderViewRow(scaleIdx);
     }
+    m_viewDirty = false;
 }
 
-QColor ScalogramWidget::valueToColor(double magnitude, double maxMagnitude)
+void ScalogramWidget::renderViewRow(size_t scaleIdx)
 {
-    double normalized = magnitude / maxMagnitude;
-    normalized = qBound(0.0, normalized, 1.0);
+    if (m_viewImage.isNull() || scaleIdx >= static_cast<size_t>(m_viewImage.height())) {
+        return;
+    }
     
+    QRgb *line = reinterpret_cast<QRgb *>(m_viewImage.scanLine(m_viewImage.height() - 1 - static_cast<int>(scaleIdx)));
+    const size_t width = m_viewImage.width();
     
-    if (normalized < 0.25) {
-        
-        double t = normalized / 0.25;
-        return QColor(0, static_cast<int>(255 * t), 255);
-    } else if (normalized < 0.5) {
-        
-        double t = (normalized - 0.25) / 0.25;
-        return QColor(0, 255, static_cast<int>(255 * (1 - t)));
-    } else if (normalized < 0.75) {
-        
-        double t = (normalized - 0.5) / 0.25;
-        return QColor(static_cast<int>(255 * t), 255, 0);
-    } else {
-        
-        double t = (normalized - 0.75) / 0.25;
-        return QColor(255, static_cast<int>(255 * (1 - t)), 0);
+    // Rows that have not arrived yet stay blank
+    if (!m_pyramid.rowReady(scaleIdx)) {
+        std::fill(line, line + width, QColor(230, 230, 230).rgb());
+        return;
+    }
+    
+    // The pyramid reads about one pooled cell per pixel, whatever the zoom
+    m_pixelMagnitudes.resize(width);
+    m_pyramid.sample(scaleIdx, m_viewFirstColumn, m_viewColumns / width, width, m_pooling,
+                     m_pixelMagnitudes.data());
+    m_palette.colorize(m_pixelMagnitudes.data(), width, line);
+}
+
+bool ScalogramWidget::updatePalette(double maxMagnitude)
+{
+    if (maxMagnitude < 1e-10) {
+        maxMagnitude = 1.0;
     }
+    if (m_palette.colormap() == m_colormap && m_palette.scaling() == m_scaling &&
+        m_palette.maxMagnitude() == maxMagnitude) {
+        return false;
+    }
+    m_palette = ScalogramImage::Palette(m_colormap, m_scaling, maxMagnitude);
+    return true;
 }
 
 void ScalogramWidget::paintEvent(QPaintEvent *event)
 {
+    PerfRecorder::Scope scope("scalogram paint");
     QPainter painter(this);
     painter.fillRect(rect(), Qt::white);
     
-    if (m_scalogramImage.isNull()) {
+    const QRect plotArea = this->plotArea();
+    if (!m_live && m_pyramid.rows() != 0 &&
+        (m_viewDirty || m_viewImage.width() != plotArea.width())) {
+        renderView(plotArea.width());
+    }
+    
+    const QImage &image = m_live ? m_scalogramImage : m_viewImage;
+    if (image.isNull() || m_time.empty()) {
         painter.setPen(Qt::gray);
         painter.drawText(rect(), Qt::AlignCenter, "No CWT data - perform analysis first");
         return;
     }
     
-    const int margin = 50;
-    const QRect plotArea(margin, margin, width() - 100, height() - 2 * margin);
-    
     
-    painter.drawImage(plotArea, m_scalogramImage);
+    // The view image already has the plot's width, so only the scale axis
+    // is stretched
+    painter.drawImage(plotArea, image);
     
     
     painter.setPen(Qt::black);
     painter.setFont(QFont("Arial", 10));
     
     
+    const double firstColumn = m_live ? 0.0 : m_viewFirstColumn;
+    const double visibleColumns = m_live ? static_cast<double>(m_time.size()) : m_viewColumns;
     painter.drawLine(plotArea.bottomLeft(), plotArea.bottomRight());
     for (int i = 0; i <= 5; ++i) {
         int x = plotArea.left() + i * plotArea.width() / 5;
         painter.drawLine(x, plotArea.bottom(), x, plotArea.bottom() + 5);
         
-        if (i < m_time.size()) {
-            int timeIdx = i * (m_time.size() - 1) / 5;
-            QString label = QString::number(m_time[timeIdx], 'f', 3);
-            painter.drawText(x - 25, plotArea.bottom() + 10, 50, 20, 
-                           Qt::AlignCenter, label);
-        }
+        size_t timeIdx = std::min(m_time.size() - 1,
+                                  static_cast<size_t>(firstColumn + i * (visibleColumns - 1) / 5));
+        QString label = QString::number(m_time[timeIdx], 'f', 3);
+        painter.drawText(x - 25, plotArea.bottom() + 10, 50, 20, 
+                       Qt::AlignCenter, label);
     }
     
     
@@ -329,7 +527,14 @@ void ScalogramWidget::paintEvent(QPaintEvent *event)
                     Qt::AlignCenter, "Time (s)");
     
     painter.drawText(plotArea.right() + 10, 20, 80, 20, 
-                    Qt::AlignLeft, "Magnitude");
+                    Qt::AlignLeft, m_scaling == ScalogramImage::Decibel ? "|W| (dB)" : "Magnitude");
+    
+    if (!m_live && m_viewColumns < m_pyramid.columns()) {
+        painter.drawText(plotArea.left(), 20, plotArea.width(), 20, Qt::AlignLeft,
+                         QString("Zoom %1x, %2 - double-click to reset")
+                         .arg(m_pyramid.columns() / m_viewColumns, 0, 'f', 1)
+                         .arg(m_pooling == ScalogramPyramid::Peak ? "peak" : "mean"));
+    }
 }
 
 void ScalogramWidget::drawColorScale(QPainter &painter)
@@ -340,7 +545,7 @@ void ScalogramWidget::drawColorScale(QPainter &painter)
     
     for (int y = 0; y < colorScale.height(); ++y) {
         double normalized = 1.0 - static_cast<double>(y) / colorScale.height();
-        QColor color = valueToColor(normalized, 1.0);
+        QColor color(ScalogramImage::mapColor(m_colormap, normalized));
         painter.fillRect(colorScale.x(), colorScale.y() + y, colorScale.width(), 1, color);
     }
     
@@ -354,6 +559,10 @@ void ScalogramWidget::drawColorScale(QPainter &painter)
         int y = colorScale.bottom() - i * colorScale.height() / 5;
         double value = static_cast<double>(i) / 5;
         QString label = QString::number(value, 'f', 1);
+        if (m_scaling == ScalogramImage::Decibel) {
+            // Relative to the largest |W|
+            label = QString::number((value - 1.0) * m_palette.dynamicRangeDb(), 'f', 0);
+        }
         painter.drawText(colorScale.right() + 5, y - 5, 30, 10, 
                         Qt::AlignLeft | Qt::AlignVCenter, label);
     }
@@ -361,6 +570,129 @@ void ScalogramWidget::drawColorScale(QPainter &painter)
 
 void ScalogramWidget::mousePressEvent(QMouseEvent *event)
 {
-    
+    if (!m_live && event->button() == Qt::LeftButton && plotArea().contains(event->pos())) {
+        m_panning = true;
+        m_lastPanPoint = event->pos();
+        return;
+    }
     QWidget::mousePressEvent(event);
 }
+
+void ScalogramWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!m_panning) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    
+    // Dragging moves the content with the cursor
+    const int dx = event->pos().x() - m_lastPanPoint.x();
+    m_lastPanPoint = event->pos();
+    m_viewFirstColumn -= dx * m_viewColumns / plotArea().width();
+    clampView();
+    m_viewDirty = true;
+    update();
+}
+
+void ScalogramWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    m_panning = false;
+    QWidget::mouseReleaseEvent(event);
+}
+
+void ScalogramWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    if (!m_live) {
+        resetZoom();
+    }
+    QWidget::mouseDoubleClickEvent(event);
+}
+
+void ScalogramWidget::wheelEvent(QWheelEvent *event)
+{
+    if (m_live || m_pyramid.columns() == 0) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+    
+    // Zoom the time axis about the column under the cursor, down to eight
+    // pixels per column
+    const QRect area = plotArea();
+    clampView();
+    const double fraction = qBound(0.0, static_cast<double>(event->pos().x() - area.left()) / area.width(), 1.0);
+    const double anchor = m_viewFirstColumn + fraction * m_viewColumns;
+    const double scaleFactor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    const double minColumns = std::min(static_cast<double>(m_pyramid.columns()), std::max(2.0, area.width() / 8.0));
+    
+    m_viewColumns = qBound(minColumns, m_viewColumns * scaleFactor, static_cast<double>(m_pyramid.columns()));
+    m_viewFirstColumn = anchor - fraction * m_viewColumns;
+    clampView();
+    m_viewDirty = true;
+    update();
+    event->accept();
+}
+
+void ScalogramWidget::contextMenuEvent(QContextMenuEvent *event)
+{
+    static const char *const colormapNames[ScalogramImage::kColormapCount] = {
+        "Rainbow", "Viridis", "Inferno", "Grayscale"
+    };
+    
+    // The live view only recolours the columns that arrive afterwards, and
+    // does not zoom
+    QMenu menu(this);
+    QMenu *colormapMenu = menu.addMenu("Colormap");
+    QAction *colormaps[ScalogramImage::kColormapCount];
+    for (int i = 0; i < ScalogramImage::kColormapCount; ++i) {
+        colormaps[i] = colormapMenu->addAction(colormapNames[i]);
+        colormaps[i]->setCheckable(true);
+        colormaps[i]->setChecked(m_colormap == i);
+    }
+    QAction *decibel = menu.addAction(QString("Decibel Scale (%1 dB)")
+                                      .arg(ScalogramImage::kDefaultDynamicRangeDb, 0, 'f', 0));
+    decibel->setCheckable(true);
+    decibel->setChecked(m_scaling == ScalogramImage::Decibel);
+    
+    QAction *peak = nullptr;
+    QAction *mean = nullptr;
+    QAction *reset = nullptr;
+    if (!m_live) {
+        menu.addSeparator();
+        peak = menu.addAction("Peak |W| per pixel");
+        mean = menu.addAction("Mean |W| per pixel");
+        peak->setCheckable(true);
+        mean->setCheckable(true);
+        peak->setChecked(m_pooling == ScalogramPyramid::Peak);
+        mean->setChecked(m_pooling == ScalogramPyramid::Mean);
+        menu.addSeparator();
+        reset = menu.addAction("Reset Zoom");
+    }
+    
+    QAction *chosen = menu.exec(event->globalPos());
+    if (!chosen) {
+        return;
+    }
+    
+    bool recolour = false;
+    for (int i = 0; i < ScalogramImage::kColormapCount; ++i) {
+        if (chosen == colormaps[i]) {
+            m_colormap = static_cast<ScalogramImage::Colormap>(i);
+            recolour = true;
+        }
+    }
+    if (chosen == decibel) {
+        m_scaling = m_scaling == ScalogramImage::Decibel ? ScalogramImage::Linear : ScalogramImage::Decibel;
+        recolour = true;
+    }
+    
+    if (recolour) {
+        m_viewDirty = true;
+        update();
+    } else if (chosen == peak || chosen == mean) {
+        m_pooling = chosen == peak ? ScalogramPyramid::Peak : ScalogramPyramid::Mean;
+        m_viewDirty = true;
+        update();
+    } else if (chosen == reset) {
+        resetZoom();
+    }
+}
@@ -0,0 +1,292 @@
+#include "ResultCache.h"
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+static const char kEntrySuffix[] = ".mdscwz";
+static const char kTemporarySuffix[] = ".tmp";
+// A temporary file not written to for this long belongs to a store that died
+static const auto kStaleAge = std::chrono::hours(1);
+// Files are hashed in blocks of this size, which the pool's workers share
+static const size_t kHashBlock = 8 * 1024 * 1024;
+
+static const uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+static const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t kPrime3 = 0x165667B19E3779F9ull;
+
+static uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t readWord(const unsigned char *data)
+{
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static uint64_t mixLane(uint64_t lane, uint64_t word)
+{
+    return rotateLeft(lane + word * kPrime2, 31) * kPrime1;
+}
+
+// Four independent lanes over 32-byte stripes, so the multiplies of one
+// stripe overlap; the finalizer spreads every input bit over the result
+static uint64_t hashBytes(const unsigned char *data, size_t size, uint64_t seed)
+{
+    uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            lanes[lane] = mixLane(lanes[lane], readWord(data + offset + 8 * lane));
+        }
+    }
+    
+    uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12)
+                    + rotateLeft(lanes[3], 18) + size;
+    for (; offset + 8 <= size; offset += 8) {
+        hash = rotateLeft(hash ^ mixLane(0, readWord(data + offset)), 27) * kPrime1 + kPrime3;
+    }
+    for (; offset < size; ++offset) {
+        hash = rotateLeft(hash ^ (data[offset] * kPrime3), 11) * kPrime1;
+    }
+    
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static std::string hexDigits(uint64_t value)
+{
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+static int64_t lastUsedStamp(const fs::path &path, std::error_code &error)
+{
+    return static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+}
+
+static uint64_t processId()
+{
+#ifdef _WIN32
+    return static_cast<uint64_t>(_getpid());
+#else
+    return static_cast<uint64_t>(getpid());
+#endif
+}
+
+ResultCache::ResultCache(const std::string &directory, uint64_t maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+{
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error) {
+        throw std::runtime_error("Cannot create " + directory + ": " + error.message());
+    }
+}
+
+std::string ResultCache::fileHash(const std::string &path, ThreadPool *pool)
+{
+    MappedFile file(path);
+    file.adviseSequential();
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(file.data());
+    const size_t blocks = (file.size() + kHashBlock - 1) / kHashBlock;
+    
+    // Block hashes are combined in order, so the result is the same
+    // however many workers there are
+    std::vector<uint64_t> blockHashes(blocks);
+    auto hashBlock = [&](size_t block, size_t) {
+        const size_t begin = block * kHashBlock;
+        blockHashes[block] = hashBytes(data + begin, std::min(kHashBlock, file.size() - begin), block);
+    };
+    if (pool) {
+        pool->parallelFor(blocks, hashBlock);
+    } else {
+        for (size_t block = 0; block < blocks; ++block) {
+            hashBlock(block, 0);
+        }
+    }
+    return hexDigits(hashBytes(reinterpret_cast<const unsigned char *>(blockHashes.data()),
+                               blockHashes.size() * sizeof(uint64_t), file.size()));
+}
+
+std::string ResultCache::makeKey(const std::string &description)
+{
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(description.data());
+    return hexDigits(hashBytes(data, description.size(), 0)) + hexDigits(hashBytes(data, description.size(), kPrime3));
+}
+
+std::string ResultCache::entryPath(const std::string &key) const
+{
+    return (fs::path(m_directory) / (key + kEntrySuffix)).string();
+}
+
+std::string ResultCache::temporaryPath(const std::string &key) const
+{
+    static std::atomic<uint64_t> s_counter(0);
+    const uint64_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return entryPath(key) + "." + std::to_string(processId()) + "-" + hexDigits(thread) + "-"
+           + std::to_string(s_counter++) + kTemporarySuffix;
+}
+
+std::unique_ptr<CoefficientArchive> ResultCache::find(const std::string &key)
+{
+    const std::string path = entryPath(key);
+    std::error_code error;
+    if (!fs::exists(path, error)) {
+        return nullptr;
+    }
+    
+    std::unique_ptr<CoefficientArchive> archive;
+    try {
+        archive.reset(new CoefficientArchive(path));
+    } catch (const std::exception &) {
+        fs::remove(path, error);
+        return nullptr;
+    }
+    // An eviction elsewhere may remove the file now; the mapping stays valid
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    return archive;
+}
+
+void ResultCache::store(const std::string &key, const CoefficientMatrix &coefficients,
+                        const std::vector<double> &scales, double samplingRate, double timeOrigin, ThreadPool *pool)
+{
+    if (coefficients.bytes() > m_maxBytes) {
+        return;
+    }
+    
+    // Written under a name of its own, then moved into place, so a reader
+    // never maps a half-written entry
+    const std::string path = entryPath(key);
+    const std::string partial = temporaryPath(key);
+    try {
+        CoefficientArchive::write(partial, coefficients, scales, samplingRate, timeOrigin, pool);
+    } catch (...) {
+        std::error_code error;
+        fs::remove(partial, error);
+        throw;
+    }
+    std::error_code error;
+    fs::rename(partial, path, error);
+    if (error) {
+        fs::remove(partial, error);
+        throw std::runtime_error("Cannot store " + path + ": " + error.message());
+    }
+    evict(key);
+}
+
+void ResultCache::remove(const std::string &key)
+{
+    std::error_code error;
+    fs::remove(entryPath(key), error);
+}
+
+void ResultCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::error_code error;
+    for (const Entry &entry : entries()) {
+        if (!entry.temporary || isStale(entry)) {
+            fs::remove(entry.path, error);
+        }
+    }
+}
+
+std::vector<ResultCache::Entry> ResultCache::entries() const
+{
+    // Files that vanish while listing belong to another eviction
+    std::vector<Entry> result;
+    std::error_code error;
+    for (fs::directory_iterator it(m_directory, error), end; !error && it != end; it.increment(error)) {
+        const fs::path &path = it->path();
+        const bool temporary = path.extension() == kTemporarySuffix;
+        if (path.extension() != kEntrySuffix && !temporary) {
+            continue;
+        }
+        std::error_code entryError;
+        Entry entry;
+        entry.path = path.string();
+        entry.temporary = temporary;
+        entry.bytes = fs::file_size(path, entryError);
+        entry.lastUsed = lastUsedStamp(path, entryError);
+        if (!entryError) {
+            result.push_back(entry);
+        }
+    }
+    return result;
+}
+
+uint64_t ResultCache::totalBytes() const
+{
+    uint64_t total = 0;
+    for (const Entry &entry : entries()) {
+        total += entry.bytes;
+    }
+    return total;
+}
+
+size_t ResultCache::entryCount() const
+{
+    const std::vector<Entry> all = entries();
+    return std::count_if(all.begin(), all.end(), [](const Entry &entry) { return !entry.temporary; });
+}
+
+bool ResultCache::isStale(const Entry &entry)
+{
+    const auto cutoff = fs::file_time_type::clock::now() - kStaleAge;
+    return entry.lastUsed < static_cast<int64_t>(cutoff.time_since_epoch().count());
+}
+
+void ResultCache::evict(const std::string &keep)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Entry> all = entries();
+    std::error_code error;
+    uint64_t total = 0;
+    for (const Entry &entry : all) {
+        if (entry.temporary && isStale(entry) && fs::remove(entry.path, error)) {
+            continue;
+        }
+        total += entry.bytes;
+    }
+    std::sort(all.begin(), all.end(), [](const Entry &a, const Entry &b) { return a.lastUsed < b.lastUsed; });
+    
+    // Stores still in progress count against the budget but are left alone
+    const std::string keepPath = entryPath(keep);
+    for (const Entry &entry : all) {
+        if (total <= m_maxBytes) {
+            break;
+        }
+        if (!entry.temporary && entry.path != keepPath && fs::remove(entry.path, error)) {
+            total -= entry.bytes;
+        }
+    }
+}
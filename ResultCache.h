@@ -0,0 +1,77 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "CoefficientArchive.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+
+// Content-addressed store of finished transforms: one CoefficientArchive
+// per key in a directory, kept under a byte budget by dropping the least
+// recently used entries first. An entry's modification time marks its
+// last use. Entries appear by rename once complete, so several threads or
+// program instances can share the directory; the temporary files of writes
+// that died are removed once they have not been written to for an hour.
+class ResultCache
+{
+public:
+    ResultCache(const std::string &directory, uint64_t maxBytes);
+    
+    const std::string &directory() const { return m_directory; }
+    uint64_t maxBytes() const { return m_maxBytes; }
+    
+    // 64-bit hash of a file's bytes as 16 hex digits, hashed in parallel
+    // blocks on pool when one is given; throws std::runtime_error if the
+    // file cannot be read
+    static std::string fileHash(const std::string &path, ThreadPool *pool = nullptr);
+    // 128-bit hash of a description of everything a result depends on, as
+    // 32 hex digits: the key of that result
+    static std::string makeKey(const std::string &description);
+    
+    // The entry of key, marked as just used, or nullptr if there is none.
+    // An entry that does not open as an archive is removed.
+    std::unique_ptr<CoefficientArchive> find(const std::string &key);
+    
+    // Saves a result under key and trims the directory to the budget. A
+    // result larger than the whole budget is not kept. Throws
+    // std::runtime_error on I/O errors.
+    void store(const std::string &key, const CoefficientMatrix &coefficients, const std::vector<double> &scales,
+               double samplingRate, double timeOrigin, ThreadPool *pool = nullptr);
+    
+    void remove(const std::string &key);
+    // Removes every entry and stale temporary file
+    void clear();
+    // Bytes of entries and temporary files
+    uint64_t totalBytes() const;
+    size_t entryCount() const;
+
+private:
+    struct Entry {
+        std::string path;
+        uint64_t bytes;
+        int64_t lastUsed;
+        bool temporary;      // a store in progress, or one that died
+    };
+    
+    std::string entryPath(const std::string &key) const;
+    // A temporary name for an entry of key, unique across threads and
+    // processes
+    std::string temporaryPath(const std::string &key) const;
+    std::vector<Entry> entries() const;
+    static bool isStale(const Entry &entry);
+    // Removes stale temporary files, then the least recently used entries
+    // other than keep until the rest fit the budget
+    void evict(const std::string &keep);
+    
+    std::string m_directory;
+    uint64_t m_maxBytes;
+    std::mutex m_mutex;          // one eviction at a time within the process
+};
+
+#endif
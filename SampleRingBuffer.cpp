@@ -0,0 +1,58 @@
+#include "SampleRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+static size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+SampleRingBuffer::SampleRingBuffer(size_t channels, size_t capacityFrames)
+    : m_channels(std::max<size_t>(channels, 1))
+    , m_mask(roundUpToPowerOfTwo(std::max<size_t>(capacityFrames, 2)) - 1)
+    , m_data((m_mask + 1) * m_channels)
+    , m_head(0)
+    , m_tail(0)
+    , m_dropped(0)
+{
+}
+
+bool SampleRingBuffer::push(const double *frame)
+{
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    std::memcpy(&m_data[(head & m_mask) * m_channels], frame, m_channels * sizeof(double));
+    // Publishes the frame contents together with the new head
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t SampleRingBuffer::pop(double *out, size_t maxFrames)
+{
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    const size_t count = std::min(maxFrames, m_head.load(std::memory_order_acquire) - tail);
+    
+    // At most two contiguous runs, split where the storage wraps
+    const size_t first = std::min(count, m_mask + 1 - (tail & m_mask));
+    std::memcpy(out, &m_data[(tail & m_mask) * m_channels], first * m_channels * sizeof(double));
+    std::memcpy(out + first * m_channels, m_data.data(), (count - first) * m_channels * sizeof(double));
+    
+    // Hands the slots back to the producer only after they were copied
+    m_tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+size_t SampleRingBuffer::available() const
+{
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+#ifndef SAMPLERINGBUFFER_H
+#define SAMPLERINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+// Single-producer single-consumer queue of multi-channel frames. One
+// thread pushes, one thread pops, and neither ever locks or waits; a full
+// buffer drops the incoming frame and counts it instead.
+class SampleRingBuffer
+{
+public:
+    // capacityFrames is rounded up to a power of two
+    SampleRingBuffer(size_t channels, size_t capacityFrames);
+    
+    SampleRingBuffer(const SampleRingBuffer &) = delete;
+    SampleRingBuffer &operator=(const SampleRingBuffer &) = delete;
+    
+    size_t channels() const { return m_channels; }
+    size_t capacity() const { return m_mask + 1; }
+    
+    // Producer side: appends one frame of channels() values
+    bool push(const double *frame);
+    
+    // Consumer side: moves up to maxFrames frames, interleaved, into out
+    size_t pop(double *out, size_t maxFrames);
+    
+    size_t available() const;
+    size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    size_t m_channels;
+    size_t m_mask;
+    std::vector<double> m_data;
+    
+    // Frame counters that only ever grow; each is written by one side.
+    // Kept on separate cache lines so the two threads do not share one.
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    std::atomic<size_t> m_dropped;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "ScalogramImage.h"
+#include "PerfRecorder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// Nine evenly spaced stops of the perceptually uniform maps, after
+// matplotlib's tables; colours in between are interpolated linearly
+static const unsigned char kViridis[9][3] = {
+    {68, 1, 84}, {71, 44, 122}, {59, 81, 139}, {44, 113, 142}, {33, 144, 141},
+    {39, 173, 129}, {92, 200, 99}, {170, 220, 50}, {253, 231, 37}
+};
+static const unsigned char kInferno[9][3] = {
+    {0, 0, 4}, {31, 12, 72}, {85, 15, 109}, {136, 34, 106}, {186, 54, 85},
+    {227, 89, 51}, {249, 140, 10}, {249, 201, 50}, {252, 255, 164}
+};
+
+// Entries of a linear palette
+static const size_t kLinearEntries = 4096;
+
+static QRgb interpolateStops(const unsigned char stops[9][3], double t)
+{
+    const double position = t * 8.0;
+    const int stop = std::min(static_cast<int>(position), 7);
+    const double fraction = position - stop;
+    int channels[3];
+    for (int c = 0; c < 3; ++c) {
+        channels[c] = static_cast<int>(stops[stop][c] + fraction * (stops[stop + 1][c] - stops[stop][c]) + 0.5);
+    }
+    return qRgb(channels[0], channels[1], channels[2]);
+}
+
+const char *ScalogramImage::colormapName(Colormap colormap)
+{
+    switch (colormap) {
+    case Viridis:
+        return "viridis";
+    case Inferno:
+        return "inferno";
+    case Grayscale:
+        return "gray";
+    case Rainbow:
+    default:
+        return "rainbow";
+    }
+}
+
+QRgb ScalogramImage::mapColor(Colormap colormap, double t)
+{
+    t = std::min(std::max(t, 0.0), 1.0);
+    switch (colormap) {
+    case Viridis:
+        return interpolateStops(kViridis, t);
+    case Inferno:
+        return interpolateStops(kInferno, t);
+    case Grayscale: {
+        const int level = static_cast<int>(255 * t + 0.5);
+        return qRgb(level, level, level);
+    }
+    case Rainbow:
+    default:
+        break;
+    }
+    
+    if (t < 0.25) {
+        return qRgb(0, static_cast<int>(255 * (t / 0.25)), 255);
+    } else if (t < 0.5) {
+        return qRgb(0, 255, static_cast<int>(255 * (1 - (t - 0.25) / 0.25)));
+    } else if (t < 0.75) {
+        return qRgb(static_cast<int>(255 * ((t - 0.5) / 0.25)), 255, 0);
+    } else {
+        return qRgb(255, static_cast<int>(255 * (1 - (t - 0.75) / 0.25)), 0);
+    }
+}
+
+QColor ScalogramImage::color(double magnitude, double maxMagnitude)
+{
+    return QColor(mapColor(Rainbow, magnitude / maxMagnitude));
+}
+
+ScalogramImage::Palette::Palette()
+    : Palette(Rainbow, Linear, 1.0)
+{
+}
+
+ScalogramImage::Palette::Palette(Colormap colormap, Scaling scaling, double maxMagnitude, double dynamicRangeDb)
+    : m_colormap(colormap)
+    , m_scaling(scaling)
+    , m_maxMagnitude(maxMagnitude > 1e-10 ? maxMagnitude : 1.0)
+    , m_dynamicRangeDb(std::min(std::max(dynamicRangeDb, 1.0), 200.0))
+    , m_scale(0.0f)
+    , m_last(0.0f)
+    , m_floorBits(0)
+    , m_lastEntry(0)
+{
+    if (m_scaling == Linear) {
+        m_table.resize(kLinearEntries);
+        for (size_t i = 0; i < kLinearEntries; ++i) {
+            m_table[i] = mapColor(colormap, static_cast<double>(i) / (kLinearEntries - 1));
+        }
+        m_last = static_cast<float>(kLinearEntries - 1);
+        m_scale = static_cast<float>(m_last / m_maxMagnitude);
+        return;
+    }
+    
+    // Entry i covers the floats whose bits lie in
+    // [floorBits + i << shift, floorBits + (i + 1) << shift): the floor is
+    // the quietest |W| still shown, max |W| falls in the last entry
+    const float floor = static_cast<float>(m_maxMagnitude * std::pow(10.0, -m_dynamicRangeDb / 20.0));
+    const float top = static_cast<float>(m_maxMagnitude);
+    int32_t topBits;
+    std::memcpy(&m_floorBits, &floor, sizeof(m_floorBits));
+    std::memcpy(&topBits, &top, sizeof(topBits));
+    m_lastEntry = (topBits - m_floorBits) >> kMantissaShift;
+    
+    m_table.resize(static_cast<size_t>(m_lastEntry) + 1);
+    for (int32_t i = 0; i <= m_lastEntry; ++i) {
+        const int32_t middleBits = m_floorBits + (i << kMantissaShift) + (1 << (kMantissaShift - 1));
+        float middle;
+        std::memcpy(&middle, &middleBits, sizeof(middle));
+        const double decibels = 20.0 * std::log10(middle / m_maxMagnitude);
+        m_table[i] = mapColor(colormap, 1.0 + decibels / m_dynamicRangeDb);
+    }
+    // Zero and everything below the floor share the first entry
+    m_table[0] = mapColor(colormap, 0.0);
+}
+
+void ScalogramImage::Palette::colorize(const float *magnitudes, size_t count, QRgb *out) const
+{
+    const QRgb *table = m_table.data();
+    if (m_scaling == Linear) {
+        const float scale = m_scale;
+        const float last = m_last;
+        for (size_t i = 0; i < count; ++i) {
+            const float position = std::min(last, magnitudes[i] * scale);
+            out[i] = table[static_cast<int32_t>(position + 0.5f)];
+        }
+        return;
+    }
+    
+    const int32_t floorBits = m_floorBits;
+    const int32_t lastEntry = m_lastEntry;
+    for (size_t i = 0; i < count; ++i) {
+        int32_t bits;
+        std::memcpy(&bits, &magnitudes[i], sizeof(bits));
+        const int32_t entry = (bits - floorBits) >> kMantissaShift;
+        out[i] = table[std::min(std::max(entry, 0), lastEntry)];
+    }
+}
+
+QImage ScalogramImage::render(const CoefficientMatrix &coefficients, Colormap colormap, Scaling scaling,
+                              double dynamicRangeDb, ThreadPool *pool)
+{
+    if (coefficients.empty()) {
+        return QImage();
+    }
+    
+    const size_t rows = coefficients.rows();
+    const size_t columns = coefficients.columns();
+    PerfRecorder::Scope scope("scalogram image", static_cast<double>(rows) * columns);
+    const size_t workers = pool ? pool->threadCount() : 1;
+    
+    // Magnitude rows are read in place; any other format is converted row
+    // by row into a per-worker buffer, in both passes, rather than holding
+    // a float copy of the whole matrix
+    const bool direct = coefficients.format() == CoefficientMatrix::MagnitudeFloat && !coefficients.isDecimated();
+    std::vector<std::vector<float>> buffers(workers);
+    auto rowMagnitudes = [&](size_t row, size_t worker) -> const float * {
+        if (direct) {
+            return coefficients.row<float>(row).data();
+        }
+        std::vector<float> &buffer = buffers[worker];
+        buffer.resize(columns);
+        coefficients.magnitudes(row, buffer.data());
+        return buffer.data();
+    };
+    auto forEachRow = [&](const ThreadPool::Task &task) {
+        if (pool) {
+            pool->parallelFor(rows, task);
+        } else {
+            for (size_t row = 0; row < rows; ++row) {
+                task(row, 0);
+            }
+        }
+    };
+    
+    std::vector<float> rowMaxima(rows, 0.0f);
+    forEachRow([&](size_t row, size_t worker) {
+        const float *values = rowMagnitudes(row, worker);
+        float maximum = 0.0f;
+        for (size_t i = 0; i < columns; ++i) {
+            maximum = std::max(maximum, values[i]);
+        }
+        rowMaxima[row] = maximum;
+    });
+    const Palette palette(colormap, scaling, *std::max_element(rowMaxima.begin(), rowMaxima.end()),
+                          dynamicRangeDb);
+    
+    QImage image(static_cast<int>(columns), static_cast<int>(rows), QImage::Format_RGB32);
+    if (image.isNull()) {
+        return image;
+    }
+    // Workers write through the pointer; scanLine() may detach
+    uchar *bits = image.bits();
+    const size_t bytesPerLine = image.bytesPerLine();
+    forEachRow([&](size_t row, size_t worker) {
+        QRgb *line = reinterpret_cast<QRgb *>(bits + (rows - 1 - row) * bytesPerLine);
+        palette.colorize(rowMagnitudes(row, worker), columns, line);
+    });
+    return image;
+}
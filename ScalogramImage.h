@@ -0,0 +1,102 @@
+#ifndef SCALOGRAMIMAGE_H
+#define SCALOGRAMIMAGE_H
+
+#include "CoefficientMatrix.h"
+
+#include <QColor>
+#include <QImage>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class ThreadPool;
+
+
+// Colour maps and image rendering of CWT magnitudes, shared by the
+// scalogram widget and the headless PNG export. Needs QtGui only.
+class ScalogramImage
+{
+public:
+    enum Colormap {
+        Rainbow = 0,   // blue, cyan, green, yellow, red
+        Viridis = 1,
+        Inferno = 2,
+        Grayscale = 3
+    };
+    static const int kColormapCount = 4;
+    
+    enum Scaling {
+        Linear = 0,    // |W| / max |W|
+        Decibel = 1    // 20 log10(|W| / max |W|) over a fixed dynamic range
+    };
+    
+    static constexpr double kDefaultDynamicRangeDb = 60.0;
+    
+    // Lower-case name, as the command line and the settings spell it
+    static const char *colormapName(Colormap colormap);
+    
+    // Colour of position t in [0, 1] of a colour map
+    static QRgb mapColor(Colormap colormap, double t);
+    
+    // Rainbow colour of magnitude, linear from 0 to maxMagnitude
+    static QColor color(double magnitude, double maxMagnitude);
+    
+    // Lookup table from |W| straight to a pixel, for one colour map,
+    // scaling and maximum. Linear scaling indexes 4096 entries by
+    // |W| * 4095 / max; decibel scaling indexes by the float's bit pattern,
+    // whose exponent and top eight mantissa bits give 256 entries per
+    // octave, so neither needs a branch or a logarithm per pixel.
+    class Palette
+    {
+    public:
+        Palette();
+        Palette(Colormap colormap, Scaling scaling, double maxMagnitude,
+                double dynamicRangeDb = kDefaultDynamicRangeDb);
+        
+        Colormap colormap() const { return m_colormap; }
+        Scaling scaling() const { return m_scaling; }
+        double maxMagnitude() const { return m_maxMagnitude; }
+        double dynamicRangeDb() const { return m_dynamicRangeDb; }
+        
+        QRgb color(float magnitude) const { return m_table[index(magnitude)]; }
+        void colorize(const float *magnitudes, size_t count, QRgb *out) const;
+    
+    private:
+        size_t index(float magnitude) const
+        {
+            if (m_scaling == Linear) {
+                // The min also sends NaN to the top entry
+                const float position = std::min(m_last, magnitude * m_scale);
+                return static_cast<size_t>(static_cast<int32_t>(position + 0.5f));
+            }
+            // Positive floats sort like their bit patterns
+            int32_t bits;
+            std::memcpy(&bits, &magnitude, sizeof(bits));
+            const int32_t entry = (bits - m_floorBits) >> kMantissaShift;
+            return static_cast<size_t>(std::min(std::max(entry, 0), m_lastEntry));
+        }
+        
+        static const int kMantissaShift = 15;
+        
+        Colormap m_colormap;
+        Scaling m_scaling;
+        double m_maxMagnitude;
+        double m_dynamicRangeDb;
+        float m_scale;
+        float m_last;
+        int32_t m_floorBits;
+        int32_t m_lastEntry;
+        std::vector<QRgb> m_table;
+    };
+    
+    // One pixel per coefficient, the first scale in the bottom row,
+    // normalized to the largest |W| of the matrix. Rows are split over pool
+    // when one is given.
+    static QImage render(const CoefficientMatrix &coefficients, Colormap colormap = Rainbow,
+                         Scaling scaling = Linear, double dynamicRangeDb = kDefaultDynamicRangeDb,
+                         ThreadPool *pool = nullptr);
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "ScalogramPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Levels stop once they are this narrow; coarser ones would save nothing
+static const size_t kMinLevelColumns = 64;
+
+ScalogramPyramid::ScalogramPyramid()
+    : m_columns(0)
+    , m_maxMagnitude(0.0)
+{
+}
+
+void ScalogramPyramid::reset(size_t rows, size_t columns)
+{
+    m_coefficients.reset();
+    m_rowReady.assign(rows, 0);
+    m_columns = columns;
+    m_maxMagnitude = 0.0;
+    m_levels.clear();
+    
+    for (size_t factor = kFirstFactor; (columns + factor - 1) / factor >= kMinLevelColumns; factor *= 2) {
+        Level level;
+        level.factor = factor;
+        level.columns = (columns + factor - 1) / factor;
+        level.peak.assign(rows * level.columns, 0.0f);
+        level.mean.assign(rows * level.columns, 0.0f);
+        m_levels.push_back(std::move(level));
+    }
+}
+
+void ScalogramPyramid::build(const std::shared_ptr<const CoefficientMatrix> &coefficients)
+{
+    reset(coefficients ? coefficients->rows() : 0, coefficients ? coefficients->columns() : 0);
+    for (size_t row = 0; row < rows(); ++row) {
+        addRow(coefficients, row);
+    }
+}
+
+void ScalogramPyramid::addRow(const std::shared_ptr<const CoefficientMatrix> &coefficients, size_t row)
+{
+    if (!coefficients || row >= rows() || coefficients->columns() != m_columns) {
+        return;
+    }
+    m_coefficients = coefficients;
+    m_rowReady[row] = 1;
+    
+    m_scratch.resize(m_columns);
+    coefficients->magnitudes(row, m_scratch.data());
+    for (float magnitude : m_scratch) {
+        m_maxMagnitude = std::max(m_maxMagnitude, static_cast<double>(magnitude));
+    }
+    if (m_levels.empty()) {
+        return;
+    }
+    
+    // Level 0 straight from the magnitudes
+    Level &first = m_levels[0];
+    float *peak = &first.peak[row * first.columns];
+    float *mean = &first.mean[row * first.columns];
+    for (size_t cell = 0; cell < first.columns; ++cell) {
+        const size_t begin = cell * first.factor;
+        const size_t end = std::min(begin + first.factor, m_columns);
+        float cellPeak = 0.0f;
+        double sum = 0.0;
+        for (size_t column = begin; column < end; ++column) {
+            cellPeak = std::max(cellPeak, m_scratch[column]);
+            sum += m_scratch[column];
+        }
+        peak[cell] = cellPeak;
+        mean[cell] = static_cast<float>(sum / (end - begin));
+    }
+    
+    // Every further level from the one below; means are weighted by the
+    // columns each cell covers, since the last cell may be partial
+    for (size_t index = 1; index < m_levels.size(); ++index) {
+        const Level &below = m_levels[index - 1];
+        Level &level = m_levels[index];
+        const float *belowPeak = &below.peak[row * below.columns];
+        const float *belowMean = &below.mean[row * below.columns];
+        peak = &level.peak[row * level.columns];
+        mean = &level.mean[row * level.columns];
+        
+        for (size_t cell = 0; cell < level.columns; ++cell) {
+            const size_t left = 2 * cell;
+            const size_t right = std::min(left + 1, below.columns - 1);
+            const double leftWeight = static_cast<double>(std::min(below.factor, m_columns - left * below.factor));
+            const double rightWeight = right == left ? 0.0
+                : static_cast<double>(std::min(below.factor, m_columns - right * below.factor));
+            peak[cell] = std::max(belowPeak[left], belowPeak[right]);
+            mean[cell] = static_cast<float>((belowMean[left] * leftWeight + belowMean[right] * rightWeight)
+                                            / (leftWeight + rightWeight));
+        }
+    }
+}
+
+size_t ScalogramPyramid::bytes() const
+{
+    size_t total = 0;
+    for (const Level &level : m_levels) {
+        total += (level.peak.size() + level.mean.size()) * sizeof(float);
+    }
+    return total;
+}
+
+void ScalogramPyramid::sample(size_t row, double firstColumn, double columnsPerPixel, size_t pixels,
+                              Pooling pooling, float *out) const
+{
+    std::fill(out, out + pixels, 0.0f);
+    if (row >= rows() || !m_rowReady[row] || !m_coefficients || pixels == 0 || m_columns == 0) {
+        return;
+    }
+    firstColumn = std::max(firstColumn, 0.0);
+    columnsPerPixel = std::max(columnsPerPixel, 1e-9);
+    
+    // The coarsest level still finer than a pixel
+    const Level *level = nullptr;
+    for (const Level &candidate : m_levels) {
+        if (static_cast<double>(candidate.factor) <= columnsPerPixel) {
+            level = &candidate;
+        }
+    }
+    
+    // Cells of width factor, read from the level or the matrix itself
+    const double factor = level ? static_cast<double>(level->factor) : 1.0;
+    const size_t cells = level ? level->columns : m_columns;
+    const size_t firstCell = std::min(static_cast<size_t>(firstColumn / factor), cells);
+    const size_t endCell = std::min(cells, static_cast<size_t>(std::ceil((firstColumn + pixels * columnsPerPixel)
+                                                                         / factor)) + 1);
+    if (firstCell >= endCell) {
+        return;
+    }
+    
+    // Cell c is at peak[c - offset]: the scratch only holds the visible ones
+    const float *peak;
+    const float *mean;
+    size_t offset = 0;
+    if (level) {
+        peak = &level->peak[row * level->columns];
+        mean = &level->mean[row * level->columns];
+    } else {
+        m_scratch.resize(endCell - firstCell);
+        m_coefficients->magnitudes(row, firstCell, endCell - firstCell, m_scratch.data());
+        peak = m_scratch.data();
+        mean = peak;
+        offset = firstCell;
+    }
+    
+    for (size_t pixel = 0; pixel < pixels; ++pixel) {
+        const double begin = (firstColumn + pixel * columnsPerPixel) / factor;
+        const size_t cellBegin = static_cast<size_t>(begin);
+        if (cellBegin >= endCell) {
+            break;
+        }
+        const size_t cellEnd = std::min(endCell, std::max(cellBegin + 1,
+            static_cast<size_t>(std::ceil(begin + columnsPerPixel / factor))));
+        
+        if (pooling == Peak) {
+            float value = 0.0f;
+            for (size_t cell = cellBegin; cell < cellEnd; ++cell) {
+                value = std::max(value, peak[cell - offset]);
+            }
+            out[pixel] = value;
+        } else {
+            double sum = 0.0;
+            for (size_t cell = cellBegin; cell < cellEnd; ++cell) {
+                sum += mean[cell - offset];
+            }
+            out[pixel] = static_cast<float>(sum / (cellEnd - cellBegin));
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SCALOGRAMPYRAMID_H
+#define SCALOGRAMPYRAMID_H
+
+#include "CoefficientMatrix.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+// Mip-map of a coefficient matrix's |W| along time. Level 0 pools
+// kFirstFactor columns into one, every further level halves the previous
+// one, and each pooled cell keeps both the peak and the mean. A view of
+// any width then reads one or two cells per pixel from the level that
+// matches its zoom; views closer than kFirstFactor columns per pixel read
+// the matrix itself. Rows can be added as they are finished.
+class ScalogramPyramid
+{
+public:
+    enum Pooling {
+        Peak = 0,
+        Mean = 1
+    };
+    
+    static const size_t kFirstFactor = 16;
+    
+    ScalogramPyramid();
+    
+    // Drops every level; rows x columns cells, none ready yet
+    void reset(size_t rows, size_t columns);
+    // Row row of coefficients is final: pools it into every level. All
+    // rows are read from the same matrix, which the pyramid keeps.
+    void addRow(const std::shared_ptr<const CoefficientMatrix> &coefficients, size_t row);
+    // reset() and addRow() for every row
+    void build(const std::shared_ptr<const CoefficientMatrix> &coefficients);
+    
+    size_t rows() const { return m_rowReady.size(); }
+    size_t columns() const { return m_columns; }
+    bool rowReady(size_t row) const { return m_rowReady[row] != 0; }
+    // Largest |W| of the rows added so far
+    double maxMagnitude() const { return m_maxMagnitude; }
+    size_t levelCount() const { return m_levels.size(); }
+    size_t bytes() const;
+    
+    // One value per pixel of row: pixel i covers columns
+    // [firstColumn + i * columnsPerPixel, firstColumn + (i + 1) * columnsPerPixel)
+    // and gets their peak or mean |W|. Zoomed in past one column per pixel,
+    // pixels repeat the column they fall on.
+    void sample(size_t row, double firstColumn, double columnsPerPixel, size_t pixels, Pooling pooling,
+                float *out) const;
+
+private:
+    struct Level {
+        size_t factor;           // matrix columns per cell
+        size_t columns;
+        std::vector<float> peak; // rows x columns
+        std::vector<float> mean;
+    };
+    
+    std::shared_ptr<const CoefficientMatrix> m_coefficients;
+    std::vector<char> m_rowReady;
+    size_t m_columns;
+    std::vector<Level> m_levels;
+    double m_maxMagnitude;
+    mutable std::vector<float> m_scratch;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "SignalColumn.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+SignalColumn::SignalColumn()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_type(Float64)
+    , m_origin(0.0)
+    , m_step(0.0)
+{
+}
+
+SignalColumn::SignalColumn(std::vector<double> samples)
+    : m_size(samples.size())
+    , m_type(Float64)
+    , m_origin(0.0)
+    , m_step(0.0)
+{
+    auto owned = std::make_shared<const std::vector<double>>(std::move(samples));
+    m_data = owned->data();
+    m_owner = std::move(owned);
+}
+
+SignalColumn::SignalColumn(std::shared_ptr<const void> owner, const void *data, size_t size, Type type)
+    : m_owner(std::move(owner))
+    , m_data(data)
+    , m_size(size)
+    , m_type(type)
+    , m_origin(0.0)
+    , m_step(0.0)
+{
+}
+
+SignalColumn SignalColumn::linear(double origin, double step, size_t size)
+{
+    SignalColumn column;
+    column.m_size = size;
+    column.m_type = Linear;
+    column.m_origin = origin;
+    column.m_step = step;
+    return column;
+}
+
+void SignalColumn::copy(size_t begin, size_t end, double *out) const
+{
+    switch (m_type) {
+        case Float64: {
+            const double *samples = static_cast<const double *>(m_data);
+            std::copy(samples + begin, samples + end, out);
+            break;
+        }
+        case Float32: {
+            const float *samples = static_cast<const float *>(m_data);
+            std::copy(samples + begin, samples + end, out);
+            break;
+        }
+        case Linear:
+            for (size_t i = begin; i < end; ++i) {
+                *out++ = m_origin + static_cast<double>(i) * m_step;
+            }
+            break;
+    }
+}
+
+std::pair<double, double> SignalColumn::minMax(size_t begin, size_t end) const
+{
+    switch (m_type) {
+        case Float64: {
+            const double *samples = static_cast<const double *>(m_data);
+            auto range = std::minmax_element(samples + begin, samples + end);
+            return {*range.first, *range.second};
+        }
+        case Float32: {
+            const float *samples = static_cast<const float *>(m_data);
+            auto range = std::minmax_element(samples + begin, samples + end);
+            return {*range.first, *range.second};
+        }
+        case Linear:
+            break;
+    }
+    double first = (*this)[begin];
+    double last = (*this)[end - 1];
+    return {std::min(first, last), std::max(first, last)};
+}
+
+double SignalColumn::sum(size_t begin, size_t end) const
+{
+    switch (m_type) {
+        case Float64: {
+            const double *samples = static_cast<const double *>(m_data);
+            return std::accumulate(samples + begin, samples + end, 0.0);
+        }
+        case Float32: {
+            const float *samples = static_cast<const float *>(m_data);
+            return std::accumulate(samples + begin, samples + end, 0.0);
+        }
+        case Linear:
+            break;
+    }
+    if (begin >= end) {
+        return 0.0;
+    }
+    return 0.5 * ((*this)[begin] + (*this)[end - 1]) * static_cast<double>(end - begin);
+}
+
+bool SignalColumn::sharesStorage(const SignalColumn &other) const
+{
+    if (m_type != other.m_type || m_size != other.m_size) {
+        return false;
+    }
+    if (m_type == Linear) {
+        return m_origin == other.m_origin && m_step == other.m_step;
+    }
+    return m_data == other.m_data;
+}
@@ -0,0 +1,61 @@
+#ifndef SIGNALCOLUMN_H
+#define SIGNALCOLUMN_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+// Read-only column of samples. The storage is either an owned vector, a
+// float64/float32 column inside a memory-mapped file, or a linear ramp
+// origin + i * step (generated time axes need no storage at all).
+// Copies are cheap and share the storage.
+class SignalColumn
+{
+public:
+    enum Type {
+        Float64,
+        Float32,
+        Linear
+    };
+    
+    SignalColumn();
+    explicit SignalColumn(std::vector<double> samples);
+    // data must stay valid for as long as owner is alive
+    SignalColumn(std::shared_ptr<const void> owner, const void *data, size_t size, Type type);
+    static SignalColumn linear(double origin, double step, size_t size);
+    
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    Type type() const { return m_type; }
+    
+    double operator[](size_t index) const
+    {
+        switch (m_type) {
+            case Float64: return static_cast<const double *>(m_data)[index];
+            case Float32: return static_cast<const float *>(m_data)[index];
+            case Linear: break;
+        }
+        return m_origin + static_cast<double>(index) * m_step;
+    }
+    
+    // Copies samples [begin, end) to out as doubles
+    void copy(size_t begin, size_t end, double *out) const;
+    // Smallest and largest sample in [begin, end), which must not be empty
+    std::pair<double, double> minMax(size_t begin, size_t end) const;
+    // Sum of samples [begin, end)
+    double sum(size_t begin, size_t end) const;
+    // True when both read the same samples, as copies of one column do
+    bool sharesStorage(const SignalColumn &other) const;
+
+private:
+    std::shared_ptr<const void> m_owner;
+    const void *m_data;
+    size_t m_size;
+    Type m_type;
+    double m_origin;
+    double m_step;
+};
+
+#endif
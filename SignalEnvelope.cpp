@@ -0,0 +1,148 @@
+#include "SignalEnvelope.h"
+
+#include <algorithm>
+#include <limits>
+
+
+SignalEnvelope::SignalEnvelope()
+{
+}
+
+void SignalEnvelope::build(const SignalColumn &signal)
+{
+    m_signal = signal;
+    m_levels.clear();
+    if (signal.size() < kFirstFactor) {
+        return;
+    }
+    
+    Level first;
+    const size_t cells = (signal.size() + kFirstFactor - 1) / kFirstFactor;
+    first.minima.resize(cells);
+    first.maxima.resize(cells);
+    first.sums.resize(cells);
+    for (size_t cell = 0; cell < cells; ++cell) {
+        const size_t begin = cell * kFirstFactor;
+        const size_t end = std::min(begin + kFirstFactor, signal.size());
+        const auto extrema = signal.minMax(begin, end);
+        first.minima[cell] = extrema.first;
+        first.maxima[cell] = extrema.second;
+        first.sums[cell] = signal.sum(begin, end);
+    }
+    m_levels.push_back(std::move(first));
+    
+    // A cell of the last level may stand alone; its parent copies it, so
+    // its sum is not counted twice
+    while (m_levels.back().minima.size() > 1) {
+        const Level &below = m_levels.back();
+        const size_t belowCells = below.minima.size();
+        Level level;
+        level.minima.resize((belowCells + 1) / 2);
+        level.maxima.resize((belowCells + 1) / 2);
+        level.sums.resize((belowCells + 1) / 2);
+        for (size_t cell = 0; cell < level.minima.size(); ++cell) {
+            const size_t left = 2 * cell;
+            const size_t right = std::min(left + 1, belowCells - 1);
+            level.minima[cell] = std::min(below.minima[left], below.minima[right]);
+            level.maxima[cell] = std::max(below.maxima[left], below.maxima[right]);
+            level.sums[cell] = right == left ? below.sums[left] : below.sums[left] + below.sums[right];
+        }
+        m_levels.push_back(std::move(level));
+    }
+}
+
+size_t SignalEnvelope::bytes() const
+{
+    size_t total = 0;
+    for (const Level &level : m_levels) {
+        total += (level.minima.size() + level.maxima.size() + level.sums.size()) * sizeof(double);
+    }
+    return total;
+}
+
+std::pair<double, double> SignalEnvelope::minMax(size_t begin, size_t end) const
+{
+    // Samples before the first and after the last whole level 0 cell
+    const size_t cellBegin = (begin + kFirstFactor - 1) / kFirstFactor;
+    const size_t cellEnd = end / kFirstFactor;
+    if (m_levels.empty() || cellBegin >= cellEnd) {
+        return m_signal.minMax(begin, end);
+    }
+    
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+    if (begin < cellBegin * kFirstFactor) {
+        const auto extrema = m_signal.minMax(begin, cellBegin * kFirstFactor);
+        minimum = extrema.first;
+        maximum = extrema.second;
+    }
+    if (cellEnd * kFirstFactor < end) {
+        const auto extrema = m_signal.minMax(cellEnd * kFirstFactor, end);
+        minimum = std::min(minimum, extrema.first);
+        maximum = std::max(maximum, extrema.second);
+    }
+    
+    visitCells(cellBegin, cellEnd, [&](const Level &level, size_t cell) {
+        minimum = std::min(minimum, level.minima[cell]);
+        maximum = std::max(maximum, level.maxima[cell]);
+    });
+    return {minimum, maximum};
+}
+
+double SignalEnvelope::sum(size_t begin, size_t end) const
+{
+    const size_t cellBegin = (begin + kFirstFactor - 1) / kFirstFactor;
+    const size_t cellEnd = end / kFirstFactor;
+    if (m_levels.empty() || cellBegin >= cellEnd) {
+        return m_signal.sum(begin, end);
+    }
+    
+    double total = m_signal.sum(begin, cellBegin * kFirstFactor) + m_signal.sum(cellEnd * kFirstFactor, end);
+    visitCells(cellBegin, cellEnd, [&](const Level &level, size_t cell) {
+        total += level.sums[cell];
+    });
+    return total;
+}
+
+template <typename VisitCell>
+void SignalEnvelope::visitCells(size_t first, size_t last, VisitCell visitCell) const
+{
+    // Bottom-up over the levels: a cell whose sibling is outside the range
+    // is taken at this level, the rest move up as whole parents
+    for (size_t index = 0; first < last; ++index) {
+        const Level &level = m_levels[index];
+        const bool top = index + 1 == m_levels.size();
+        if (top || (first & 1)) {
+            const size_t count = top ? last - first : 1;
+            for (size_t cell = first; cell < first + count; ++cell) {
+                visitCell(level, cell);
+            }
+            first += count;
+        }
+        if (first < last && (last & 1)) {
+            --last;
+            visitCell(level, last);
+        }
+        first /= 2;
+        last /= 2;
+    }
+}
+
+size_t SignalEnvelope::envelope(double firstSample, double samplesPerPixel, size_t pixels,
+                                double *minima, double *maxima) const
+{
+    const size_t size = m_signal.size();
+    firstSample = std::max(firstSample, 0.0);
+    for (size_t pixel = 0; pixel < pixels; ++pixel) {
+        const size_t begin = static_cast<size_t>(firstSample + pixel * samplesPerPixel);
+        if (begin >= size) {
+            return pixel;
+        }
+        const size_t end = std::min(size, std::max(begin + 1,
+            static_cast<size_t>(firstSample + (pixel + 1) * samplesPerPixel)));
+        const auto extrema = minMax(begin, end);
+        minima[pixel] = extrema.first;
+        maxima[pixel] = extrema.second;
+    }
+    return pixels;
+}
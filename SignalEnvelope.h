@@ -0,0 +1,61 @@
+#ifndef SIGNALENVELOPE_H
+#define SIGNALENVELOPE_H
+
+#include "SignalColumn.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Min/max/sum summary tree of a signal column, so that a plot of any zoom
+// can be drawn from one envelope value per pixel and a range averaged
+// without reading it. Level 0 keeps the extrema and sum of every
+// kFirstFactor samples and every further level those of two cells below,
+// up to a single cell. A range query takes whole cells from
+// the coarsest levels that fit and reads only the samples at its edges,
+// so it costs O(kFirstFactor + log n) however long the range is.
+class SignalEnvelope
+{
+public:
+    static const size_t kFirstFactor = 32;
+    
+    SignalEnvelope();
+    
+    // Summarizes signal, keeping a copy of the column (which shares the
+    // samples, so they stay alive)
+    void build(const SignalColumn &signal);
+    
+    const SignalColumn &signal() const { return m_signal; }
+    size_t bytes() const;
+    
+    // Smallest and largest sample in [begin, end), which must not be empty
+    std::pair<double, double> minMax(size_t begin, size_t end) const;
+    // Sum of the samples in [begin, end)
+    double sum(size_t begin, size_t end) const;
+    
+    // Extrema per pixel: pixel i covers samples
+    // [firstSample + i * samplesPerPixel, firstSample + (i + 1) * samplesPerPixel),
+    // and at least one sample. Stops at the end of the signal and returns
+    // the number of pixels written.
+    size_t envelope(double firstSample, double samplesPerPixel, size_t pixels,
+                    double *minima, double *maxima) const;
+
+private:
+    struct Level {
+        std::vector<double> minima;
+        std::vector<double> maxima;
+        std::vector<double> sums;
+    };
+    
+    // Calls visitCell(level, cell) for a set of cells that covers level 0
+    // cells [first, last) exactly, taking each from the coarsest level it
+    // fits in
+    template <typename VisitCell>
+    void visitCells(size_t first, size_t last, VisitCell visitCell) const;
+    
+    SignalColumn m_signal;
+    std::vector<Level> m_levels; // level l cells cover kFirstFactor << l samples
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "SignalFile.h"
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+
+static const char kMagic[8] = {'M', 'D', 'S', 'V', '2', 'S', 'I', 'G'};
+static const uint32_t kVersion = 1;
+static const uint32_t kByteOrderMark = 0x01020304;
+static const uint64_t kColumnAlignment = 4096;
+
+struct SignalFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t sampleType;
+    uint32_t reserved;
+    uint64_t channelCount;
+    uint64_t sampleCount;
+    double samplingRate;
+    double timeOrigin;
+    uint64_t columnStride;
+    uint64_t dataOffset;
+};
+
+static_assert(sizeof(SignalFileHeader) == 72, "SignalFileHeader must match the on-disk layout");
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static size_t sampleSize(uint32_t sampleType)
+{
+    return sampleType == SignalFile::Float32 ? sizeof(float) : sizeof(double);
+}
+
+bool SignalFile::isSignalFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+SignalFile::Contents SignalFile::read(const std::string &path)
+{
+    auto file = std::make_shared<MappedFile>(path);
+    
+    SignalFileHeader header;
+    if (file->size() < sizeof(header)) {
+        throw std::runtime_error("File is too short for a signal header");
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a binary signal file");
+    }
+    if (header.byteOrderMark != kByteOrderMark) {
+        throw std::runtime_error("Signal file was written with a different byte order");
+    }
+    if (header.version != kVersion) {
+        throw std::runtime_error("Unsupported signal file version");
+    }
+    if (header.sampleType != Float32 && header.sampleType != Float64) {
+        throw std::runtime_error("Unknown sample type in signal file");
+    }
+    
+    // Reject headers whose columns would reach past the end of the file;
+    // written so that no corrupt field can overflow the arithmetic
+    const uint64_t elementSize = sampleSize(header.sampleType);
+    const uint64_t fileSize = file->size();
+    bool layoutValid = header.dataOffset % elementSize == 0 &&
+                       header.columnStride % elementSize == 0 &&
+                       header.sampleCount <= header.columnStride / elementSize &&
+                       header.dataOffset <= fileSize;
+    if (layoutValid && header.channelCount > 0) {
+        const uint64_t available = fileSize - header.dataOffset;
+        const uint64_t columnBytes = header.sampleCount * elementSize;
+        layoutValid = columnBytes <= available &&
+                      (header.channelCount == 1 ||
+                       (header.columnStride > 0 &&
+                        header.channelCount - 1 <= (available - columnBytes) / header.columnStride));
+    }
+    if (!layoutValid) {
+        throw std::runtime_error("Signal file is truncated or corrupt");
+    }
+    
+    Contents contents;
+    contents.samplingRate = header.samplingRate;
+    contents.timeOrigin = header.timeOrigin;
+    contents.sampleType = static_cast<SampleType>(header.sampleType);
+    
+    const SignalColumn::Type columnType = header.sampleType == Float32 ? SignalColumn::Float32
+                                                                       : SignalColumn::Float64;
+    for (uint64_t c = 0; c < header.channelCount; ++c) {
+        const char *column = file->data() + header.dataOffset + c * header.columnStride;
+        contents.channels.emplace_back(file, column, static_cast<size_t>(header.sampleCount), columnType);
+    }
+    return contents;
+}
+
+void SignalFile::write(const std::string &path, const std::vector<SignalColumn> &channels,
+                       double samplingRate, double timeOrigin, SampleType sampleType)
+{
+    const uint64_t sampleCount = channels.empty() ? 0 : channels[0].size();
+    for (const SignalColumn &channel : channels) {
+        if (channel.size() != sampleCount) {
+            throw std::runtime_error("All channels must have the same length");
+        }
+    }
+    
+    SignalFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.sampleType = sampleType;
+    header.channelCount = channels.size();
+    header.sampleCount = sampleCount;
+    header.samplingRate = samplingRate;
+    header.timeOrigin = timeOrigin;
+    header.columnStride = alignUp(std::max<uint64_t>(sampleCount * sampleSize(sampleType), 1), kColumnAlignment);
+    header.dataOffset = kColumnAlignment;
+    
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    
+    const std::vector<char> padding(kColumnAlignment, 0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(padding.data(), header.dataOffset - sizeof(header));
+    
+    // Convert in blocks so memory use does not depend on the signal length
+    const size_t blockSamples = 65536;
+    std::vector<double> block(blockSamples);
+    std::vector<float> narrowed(sampleType == Float32 ? blockSamples : 0);
+    
+    for (const SignalColumn &channel : channels) {
+        for (size_t begin = 0; begin < sampleCount; begin += blockSamples) {
+            size_t end = std::min<size_t>(begin + blockSamples, sampleCount);
+            channel.copy(begin, end, block.data());
+            
+            if (sampleType == Float32) {
+                std::copy(block.begin(), block.begin() + (end - begin), narrowed.begin());
+                out.write(reinterpret_cast<const char *>(narrowed.data()), (end - begin) * sizeof(float));
+            } else {
+                out.write(reinterpret_cast<const char *>(block.data()), (end - begin) * sizeof(double));
+            }
+        }
+        
+        uint64_t tail = header.columnStride - sampleCount * sampleSize(sampleType);
+        while (tail > 0) {
+            uint64_t chunk = std::min<uint64_t>(tail, padding.size());
+            out.write(padding.data(), chunk);
+            tail -= chunk;
+        }
+    }
+    
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef SIGNALFILE_H
+#define SIGNALFILE_H
+
+#include "SignalColumn.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Binary columnar signal container (.mdsb).
+//
+// A 72-byte little-endian header is followed by one contiguous column per
+// channel. Columns start on 4096-byte boundaries, so a memory-mapped file
+// pages in only the channels that are actually read:
+//
+//   0  char[8]  magic "MDSV2SIG"
+//   8  uint32   version (1)
+//  12  uint32   byte order mark 0x01020304
+//  16  uint32   sample type (1 = float32, 2 = float64)
+//  20  uint32   reserved
+//  24  uint64   channel count
+//  32  uint64   samples per channel
+//  40  float64  sampling rate in Hz
+//  48  float64  time of the first sample in seconds
+//  56  uint64   column stride in bytes
+//  64  uint64   offset of the first column
+class SignalFile
+{
+public:
+    enum SampleType {
+        Float32 = 1,
+        Float64 = 2
+    };
+    
+    struct Contents {
+        // Columns point into the mapping, which they keep alive
+        std::vector<SignalColumn> channels;
+        double samplingRate;
+        double timeOrigin;
+        SampleType sampleType;
+        
+        Contents() : samplingRate(1000.0), timeOrigin(0.0), sampleType(Float64) {}
+    };
+    
+    // True if the file starts with the container's magic
+    static bool isSignalFile(const std::string &path);
+    
+    // Maps the file; throws std::runtime_error if it is not a valid container
+    static Contents read(const std::string &path);
+    
+    // Writes the channels, which must all have the same length; throws
+    // std::runtime_error on I/O errors
+    static void write(const std::string &path, const std::vector<SignalColumn> &channels,
+                      double samplingRate, double timeOrigin, SampleType sampleType);
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : m_task(nullptr)
+    , m_count(0)
+    , m_nextIndex(0)
+    , m_activeWorkers(0)
+    , m_generation(0)
+    , m_stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeCondition.notify_all();
+    
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const Task &task,
+                             const std::function<void()> &poll, int pollIntervalMs)
+{
+    if (count == 0) {
+        return;
+    }
+    
+    // One loop at a time; concurrent callers queue up here
+    std::lock_guard<std::mutex> jobLock(m_jobMutex);
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_count = count;
+    m_nextIndex.store(0);
+    m_activeWorkers = m_workers.size();
+    m_error = nullptr;
+    ++m_generation;
+    m_wakeCondition.notify_all();
+    
+    auto finished = [this]() { return m_activeWorkers == 0; };
+    while (!finished()) {
+        if (!poll) {
+            m_doneCondition.wait(lock, finished);
+            break;
+        }
+        
+        if (!m_doneCondition.wait_for(lock, std::chrono::milliseconds(pollIntervalMs), finished)) {
+            lock.unlock();
+            poll();
+            lock.lock();
+        }
+    }
+    
+    m_task = nullptr;
+    std::exception_ptr error = m_error;
+    m_error = nullptr;
+    lock.unlock();
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(size_t worker)
+{
+    uint64_t seenGeneration = 0;
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wakeCondition.wait(lock, [&]() {
+            return m_stopping || m_generation != seenGeneration;
+        });
+        if (m_stopping) {
+            return;
+        }
+        seenGeneration = m_generation;
+        
+        lock.unlock();
+        runTasks(worker);
+        lock.lock();
+        
+        if (--m_activeWorkers == 0) {
+            m_doneCondition.notify_all();
+        }
+    }
+}
+
+void ThreadPool::runTasks(size_t worker)
+{
+    for (;;) {
+        size_t index = m_nextIndex.fetch_add(1);
+        if (index >= m_count) {
+            return;
+        }
+        
+        try {
+            (*m_task)(index, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+            // Let the remaining workers drain out quickly
+            m_nextIndex.store(m_count);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fixed set of worker threads that run index-parallel loops.
+// Workers pull the next index from a shared counter, so uneven task costs
+// are balanced dynamically.
+class ThreadPool
+{
+public:
+    using Task = std::function<void(size_t index, size_t worker)>;
+    
+    // threadCount == 0 uses one worker per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    
+    size_t threadCount() const { return m_workers.size(); }
+    
+    // Runs task(i, worker) for every i in [0, count) and blocks until all
+    // have finished. While waiting, poll (if set) is called on the calling
+    // thread every pollIntervalMs. The first exception thrown by a task
+    // stops the loop and is rethrown here.
+    void parallelFor(size_t count, const Task &task,
+                     const std::function<void()> &poll = std::function<void()>(),
+                     int pollIntervalMs = 20);
+
+private:
+    void workerLoop(size_t worker);
+    void runTasks(size_t worker);
+    
+    std::vector<std::thread> m_workers;
+    std::mutex m_jobMutex;
+    
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+    
+    const Task *m_task;
+    size_t m_count;
+    std::atomic<size_t> m_nextIndex;
+    size_t m_activeWorkers;
+    uint64_t m_generation;
+    bool m_stopping;
+    std::exception_ptr m_error;
+};
+
+#endif
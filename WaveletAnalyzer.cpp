@@ -3,21 +3,89 @@
 #include <QDesktopWidget>
 #include <QScreen>
 #include <QtMath>
+#include <QThreadPool>
+#include <QtConcurrent>
 #include <QDebug>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QStandardPaths>
 #include <algorithm>
-#include <fftw3.h>
+#include <chrono>
+#include "CSVReader.h"
+#include "CoefficientArchive.h"
+#include "ComplexKernels.h"
+#include "FFTPlan.h"
+#include "LiveSource.h"
+#include "PerfRecorder.h"
+#include "ResultCache.h"
+#include "SignalFile.h"
+#include "ThreadPool.h"
+
+// How often a live source's ring buffer is drained and drawn
+static const int kLivePollIntervalMs = 10;
+// Auto-analysis preview: drawn this long after the last parameter change,
+// from at most this many columns and scales
+static const int kPreviewDelayMs = 30;
+static const size_t kPreviewColumns = 2048;
+static const size_t kPreviewScales = 48;
+// Disk space the result cache may take before the oldest entries go
+static const uint64_t kResultStoreBytes = 4ull * 1024 * 1024 * 1024;
 
 WaveletAnalyzer::WaveletAnalyzer(QWidget *parent)
     : QMainWindow(parent)
     , m_centralWidget(nullptr)
     , m_signalPlot(nullptr)
     , m_scalogramPlot(nullptr)
+    , m_cwtOverview(false)
+    , m_transform(new WaveletTransform)
+    , m_nextJobId(1)
+    , m_restartTimer(nullptr)
+    , m_previewTransform(new WaveletTransform)
+    , m_previewTimer(nullptr)
+    , m_previewShown(false)
+    , m_liveTimer(nullptr)
+    , m_stopLiveAction(nullptr)
+    , m_statsDialog(nullptr)
+    , m_statsTextEdit(nullptr)
+    , m_statsTimer(nullptr)
 {
     setupUI();
     setupMenuBar();
     
+    // Without a writable cache location results are simply not kept
+    const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheLocation.isEmpty()) {
+        try {
+            m_resultStore = std::make_shared<ResultCache>(QFile::encodeName(cacheLocation + "/results").constData(),
+                                                          kResultStoreBytes);
+        } catch (const std::exception &e) {
+            qDebug() << "Result cache disabled:" << e.what();
+        }
+    }
+    
+    // Parameter changes while a job runs, or with auto-analysis on, start
+    // a full run once the user pauses; previews follow them closely
+    m_restartTimer = new QTimer(this);
+    m_restartTimer->setSingleShot(true);
+    m_restartTimer->setInterval(250);
+    connect(m_restartTimer, &QTimer::timeout, this, &WaveletAnalyzer::performCWT);
+    
+    m_previewTimer = new QTimer(this);
+    m_previewTimer->setSingleShot(true);
+    m_previewTimer->setInterval(kPreviewDelayMs);
+    connect(m_previewTimer, &QTimer::timeout, this, &WaveletAnalyzer::showPreview);
+    
+    m_liveTimer = new QTimer(this);
+    m_liveTimer->setTimerType(Qt::PreciseTimer);
+    m_liveTimer->setInterval(kLivePollIntervalMs);
+    connect(m_liveTimer, &QTimer::timeout, this, &WaveletAnalyzer::pollLiveSource);
+    
+    connect(this, &WaveletAnalyzer::analysisProgress,
+            this, &WaveletAnalyzer::onAnalysisProgress, Qt::QueuedConnection);
+    
     
     m_cwtParams.waveletType = 0; 
+    m_cwtParams.engine = WaveletTransform::EngineAuto;
     m_cwtParams.minScale = 1;
     m_cwtParams.maxScale = 64;
     m_cwtParams.scaleSteps = 64;
@@ -31,7 +99,12 @@ WaveletAnalyzer::WaveletAnalyzer(QWidget *parent)
     resize(1200, 800);
 }
 
-WaveletAnalyzer::~WaveletAnalyzer() = default;
+WaveletAnalyzer::~WaveletAnalyzer()
+{
+    // Jobs call back into this object, so let them drain before it goes away
+    cancelActiveJob();
+    QThreadPool::globalInstance()->waitForDone();
+}
 
 void WaveletAnalyzer::setupUI()
 {
@@ -59,9 +132,6 @@ void WaveletAnalyzer::setupUI()
     controlsLayout->addStretch();
     
     
-    setupVisualization();
-    
-    
     m_mainSplitter->addWidget(controlsWidget);
     m_mainSplitter->addWidget(m_plotSplitter);
     m_mainSplitter->setSizes({300, 900});
@@ -76,6 +146,37 @@ void WaveletAnalyzer::setupMenuBar()
     connect(loadAction, &QAction::triggered, this, &WaveletAnalyzer::loadSignalFile);
     fileMenu->addAction(loadAction);
     
+    auto *saveBinaryAction = new QAction("Save as &Binary...", this);
+    connect(saveBinaryAction, &QAction::triggered, this, &WaveletAnalyzer::saveBinaryFile);
+    fileMenu->addAction(saveBinaryAction);
+    
+    auto *streamAction = new QAction("&Stream CWT to File...", this);
+    connect(streamAction, &QAction::triggered, this, &WaveletAnalyzer::streamCWTToFile);
+    fileMenu->addAction(streamAction);
+    
+    auto *exportAction = new QAction("&Export CWT Result...", this);
+    connect(exportAction, &QAction::triggered, this, &WaveletAnalyzer::exportCWTResult);
+    fileMenu->addAction(exportAction);
+    
+    auto *openResultAction = new QAction("&Open CWT Result...", this);
+    connect(openResultAction, &QAction::triggered, this, &WaveletAnalyzer::openCWTResult);
+    fileMenu->addAction(openResultAction);
+    
+    auto *clearCacheAction = new QAction("&Clear Result Cache", this);
+    connect(clearCacheAction, &QAction::triggered, this, &WaveletAnalyzer::clearResultCache);
+    fileMenu->addAction(clearCacheAction);
+    
+    fileMenu->addSeparator();
+    
+    auto *liveAction = new QAction("Open &Live Source...", this);
+    connect(liveAction, &QAction::triggered, this, &WaveletAnalyzer::openLiveSource);
+    fileMenu->addAction(liveAction);
+    
+    m_stopLiveAction = new QAction("Stop Li&ve Source", this);
+    m_stopLiveAction->setEnabled(false);
+    connect(m_stopLiveAction, &QAction::triggered, this, &WaveletAnalyzer::stopLiveSource);
+    fileMenu->addAction(m_stopLiveAction);
+    
     fileMenu->addSeparator();
     
     auto *exitAction = new QAction("E&xit", this);
@@ -83,6 +184,11 @@ void WaveletAnalyzer::setupMenuBar()
     connect(exitAction, &QAction::triggered, this, &QWidget::close);
     fileMenu->addAction(exitAction);
     
+    auto *viewMenu = menuBar()->addMenu("&View");
+    auto *statsAction = new QAction("&Performance Stats...", this);
+    connect(statsAction, &QAction::triggered, this, &WaveletAnalyzer::showPerformanceStats);
+    viewMenu->addAction(statsAction);
+    
     auto *helpMenu = menuBar()->addMenu("&Help");
     auto *aboutAction = new QAction("&About", this);
     
@@ -170,32 +276,108 @@ void WaveletAnalyzer::setupWaveletControls()
     
     
     layout->addWidget(new QLabel("Min Scale:"), 1, 0);
-    m_minScaleSpinBox = new QSpinBox;
-    m_minScaleSpinBox->setRange(1, 100);
-    m_minScaleSpinBox->setValue(1);
+    m_minScaleSpinBox = new QDoubleSpinBox;
+    m_minScaleSpinBox->setRange(0.5, 256.0);
+    m_minScaleSpinBox->setDecimals(2);
+    m_minScaleSpinBox->setSingleStep(0.5);
+    m_minScaleSpinBox->setValue(1.0);
     layout->addWidget(m_minScaleSpinBox, 1, 1);
     
     layout->addWidget(new QLabel("Max Scale:"), 2, 0);
-    m_maxScaleSpinBox = new QSpinBox;
-    m_maxScaleSpinBox->setRange(2, 512);
-    m_maxScaleSpinBox->setValue(64);
+    m_maxScaleSpinBox = new QDoubleSpinBox;
+    m_maxScaleSpinBox->setRange(1.0, 4096.0);
+    m_maxScaleSpinBox->setDecimals(2);
+    m_maxScaleSpinBox->setValue(64.0);
     layout->addWidget(m_maxScaleSpinBox, 2, 1);
     
-    layout->addWidget(new QLabel("Scale Steps:"), 3, 0);
+    layout->addWidget(new QLabel("Scale Spacing:"), 3, 0);
+    m_scaleSpacingCombo = new QComboBox;
+    m_scaleSpacingCombo->addItems({"Linear", "Octaves"});
+    m_scaleSpacingCombo->setToolTip("Linear: Scale Steps evenly spaced scales\n"
+                                    "Octaves: Voices/Octave scales per doubling, so every\n"
+                                    "octave of frequency gets the same resolution");
+    layout->addWidget(m_scaleSpacingCombo, 3, 1);
+    
+    layout->addWidget(new QLabel("Scale Steps:"), 4, 0);
     m_scaleStepsSpinBox = new QSpinBox;
-    m_scaleStepsSpinBox->setRange(10, 256);
+    m_scaleStepsSpinBox->setRange(2, 1024);
     m_scaleStepsSpinBox->setValue(64);
-    layout->addWidget(m_scaleStepsSpinBox, 3, 1);
+    layout->addWidget(m_scaleStepsSpinBox, 4, 1);
+    
+    layout->addWidget(new QLabel("Voices/Octave:"), 5, 0);
+    m_voicesSpinBox = new QSpinBox;
+    m_voicesSpinBox->setRange(1, 64);
+    m_voicesSpinBox->setValue(12);
+    m_voicesSpinBox->setEnabled(false);
+    layout->addWidget(m_voicesSpinBox, 5, 1);
+    
+    layout->addWidget(new QLabel("Engine:"), 6, 0);
+    m_engineCombo = new QComboBox;
+    m_engineCombo->addItems({"Auto", "Direct (reference)", "FFT", "Streaming (out-of-core)"});
+    m_engineCombo->setToolTip("Direct: O(scales x N^2) convolution\n"
+                              "FFT: O(scales x N log N) frequency-domain convolution\n"
+                              "Streaming: block-wise FFT with bounded memory; the scalogram\n"
+                              "shows a peak-magnitude overview of the whole range");
+    layout->addWidget(m_engineCombo, 6, 1);
+    
+    layout->addWidget(new QLabel("Support Tolerance:"), 7, 0);
+    m_toleranceCombo = new QComboBox;
+    m_toleranceCombo->addItem("Exact", 0.0);
+    m_toleranceCombo->addItem("1e-12", 1e-12);
+    m_toleranceCombo->addItem("1e-9", 1e-9);
+    m_toleranceCombo->addItem("1e-6", 1e-6);
+    m_toleranceCombo->addItem("1e-4", 1e-4);
+    m_toleranceCombo->setCurrentIndex(2);
+    m_toleranceCombo->setToolTip("Fraction of each wavelet's energy that may be cut off.\n"
+                                 "Larger values shorten the kernels and speed up the direct engine.");
+    layout->addWidget(m_toleranceCombo, 7, 1);
+    
+    layout->addWidget(new QLabel("Result Type:"), 8, 0);
+    m_resultTypeCombo = new QComboBox;
+    m_resultTypeCombo->addItems({"Complex (double)", "Complex (float)", "Magnitude (float)", "Power (float)"});
+    m_resultTypeCombo->setToolTip("How coefficients are stored: 16, 8, 4 and 4 bytes each.\n"
+                                  "Magnitude and power drop the phase but need 4x less memory.");
+    layout->addWidget(m_resultTypeCombo, 8, 1);
+    
+    m_decimateCheckBox = new QCheckBox("Decimate large scales");
+    m_decimateCheckBox->setToolTip("Store each scale only as densely as its frequency band needs.\n"
+                                   "Large scales are smooth, so they keep a fraction of the columns,\n"
+                                   "saving memory and compute; the scalogram interpolates them.\n"
+                                   "Not used when streaming.");
+    layout->addWidget(m_decimateCheckBox, 9, 0, 1, 2);
+    
+    m_allChannelsCheckBox = new QCheckBox("Analyze all channels");
+    m_allChannelsCheckBox->setToolTip("Transform every channel in one run with the FFT engine.\n"
+                                      "Switching channels afterwards shows each result instantly.");
+    layout->addWidget(m_allChannelsCheckBox, 10, 0, 1, 2);
     
     
     connect(m_waveletCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &WaveletAnalyzer::selectWavelet);
-    connect(m_minScaleSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+    connect(m_engineCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &WaveletAnalyzer::selectEngine);
+    connect(m_toleranceCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &WaveletAnalyzer::selectSupportTolerance);
+    connect(m_resultTypeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &WaveletAnalyzer::selectResultType);
+    connect(m_allChannelsCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_cwtParams.allChannels = checked;
+        restartIfRunning();
+    });
+    connect(m_minScaleSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &WaveletAnalyzer::setScaleParameters);
+    connect(m_maxScaleSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
             this, &WaveletAnalyzer::setScaleParameters);
-    connect(m_maxScaleSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+    connect(m_scaleSpacingCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &WaveletAnalyzer::setScaleParameters);
     connect(m_scaleStepsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &WaveletAnalyzer::setScaleParameters);
+    connect(m_voicesSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &WaveletAnalyzer::setScaleParameters);
+    connect(m_decimateCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_cwtParams.decimate = checked;
+        restartIfRunning();
+    });
 }
 
 void WaveletAnalyzer::setupVisualization()
@@ -205,6 +387,11 @@ void WaveletAnalyzer::setupVisualization()
     auto *analysisLayout = new QVBoxLayout(m_analysisGroup);
     
     m_analyzeButton = new QPushButton("Perform CWT Analysis");
+    m_autoAnalyzeCheckBox = new QCheckBox("Auto-analyze on changes");
+    m_autoAnalyzeCheckBox->setToolTip("Redraw the scalogram whenever a parameter changes: a coarse preview\n"
+                                      "right away, replaced by the full-resolution result once it is done.");
+    m_cancelButton = new QPushButton("Cancel");
+    m_cancelButton->setEnabled(false);
     m_resetButton = new QPushButton("Reset View");
     
     m_progressBar = new QProgressBar;
@@ -215,6 +402,8 @@ void WaveletAnalyzer::setupVisualization()
     m_infoTextEdit->setReadOnly(true);
     
     analysisLayout->addWidget(m_analyzeButton);
+    analysisLayout->addWidget(m_autoAnalyzeCheckBox);
+    analysisLayout->addWidget(m_cancelButton);
     analysisLayout->addWidget(m_resetButton);
     analysisLayout->addWidget(m_progressBar);
     analysisLayout->addWidget(m_statusLabel);
@@ -233,6 +422,13 @@ void WaveletAnalyzer::setupVisualization()
     
     
     connect(m_analyzeButton, &QPushButton::clicked, this, &WaveletAnalyzer::performCWT);
+    connect(m_cancelButton, &QPushButton::clicked, this, &WaveletAnalyzer::cancelCWT);
+    connect(m_autoAnalyzeCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked && autoAnalysisEnabled()) {
+            m_previewTimer->start();
+            m_restartTimer->start();
+        }
+    });
     connect(m_resetButton, &QPushButton::clicked, this, &WaveletAnalyzer::resetView);
 }
 
@@ -242,14 +438,38 @@ void WaveletAnalyzer::loadSignalFile()
         this,
         "Load Signal File",
         "",
-        "CSV Files (*.csv);;All Files (*)"
+        "Signal Files (*.csv *.mdsb);;CSV Files (*.csv);;Binary Signal Files (*.mdsb);;All Files (*)"
     );
     
     if (!filename.isEmpty()) {
-        if (loadCSVFile(filename)) {
+        cancelActiveJob();
+        m_channelCoefficients.clear();
+        m_resultCache.clear();
+        m_signalData.sourcePath.clear();
+        m_signalData.contentHash = QFuture<QString>();
+        
+        // The format is detected from the content, not the extension
+        bool binary = SignalFile::isSignalFile(QFile::encodeName(filename).constData());
+        if (binary ? loadBinaryFile(filename) : loadCSVFile(filename)) {
+            // The cache key names the bytes, not the path, so copies and
+            // renamed recordings hit the same entries. The file is hashed
+            // on a worker, which keeps opening it instant; the first job
+            // waits for the hash on its own worker if it is not done yet.
+            if (m_resultStore) {
+                m_signalData.sourcePath = filename;
+                m_signalData.contentHash = QtConcurrent::run([filename]() {
+                    try {
+                        return QString::fromStdString(ResultCache::fileHash(QFile::encodeName(filename).constData()));
+                    } catch (const std::exception &e) {
+                        qDebug() << "Cannot hash" << filename << ":" << e.what();
+                        return QString();
+                    }
+                });
+            }
             m_fileLabel->setText(QFileInfo(filename).fileName());
             updateSignalInfo();
             updatePlots();
+            restartIfRunning();
             m_statusLabel->setText("Signal loaded successfully");
         } else {
             QMessageBox::warning(this, "Error", "Failed to load signal file");
@@ -258,6 +478,44 @@ void WaveletAnalyzer::loadSignalFile()
     }
 }
 
+void WaveletAnalyzer::saveBinaryFile()
+{
+    if (m_signalData.channels.empty()) {
+        QMessageBox::warning(this, "Error", "No signal data loaded");
+        return;
+    }
+    
+    const QString float64Filter = "Binary Signal, float64 (*.mdsb)";
+    const QString float32Filter = "Binary Signal, float32 (*.mdsb)";
+    QString selectedFilter = float64Filter;
+    QString filename = QFileDialog::getSaveFileName(
+        this,
+        "Save as Binary",
+        QFileInfo(m_signalData.filename).completeBaseName() + ".mdsb",
+        float64Filter + ";;" + float32Filter,
+        &selectedFilter
+    );
+    
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    SignalFile::SampleType sampleType = selectedFilter == float32Filter ? SignalFile::Float32
+                                                                        : SignalFile::Float64;
+    double timeOrigin = m_signalData.timeVector.empty() ? 0.0 : m_signalData.timeVector[0];
+    
+    try {
+        SignalFile::write(QFile::encodeName(filename).constData(), m_signalData.channels,
+                          m_signalData.samplingRate, timeOrigin, sampleType);
+    } catch (const std::exception &e) {
+        QMessageBox::warning(this, "Error", QString("Failed to save binary file: %1").arg(e.what()));
+        m_statusLabel->setText("Failed to save binary file");
+        return;
+    }
+    
+    m_statusLabel->setText(QString("Saved %1").arg(QFileInfo(filename).fileName()));
+}
+
 
 void WaveletAnalyzer::detectAndSetSamplingRate()
 {
@@ -266,9 +524,8 @@ void WaveletAnalyzer::detectAndSetSamplingRate()
         double currentRate = m_samplingRateSpinBox->value();
         
         
-        for (size_t i = 0; i < m_signalData.timeVector.size(); ++i) {
-            m_signalData.timeVector[i] = static_cast<double>(i) / currentRate;
-        }
+        m_signalData.timeVector = SignalColumn::linear(0.0, 1.0 / currentRate,
+                                                       m_signalData.timeVector.size());
         
         m_signalData.samplingRate = currentRate;
         qDebug() << "Updated sampling rate to:" << currentRate << "Hz";
@@ -279,61 +536,34 @@ void WaveletAnalyzer::detectAndSetSamplingRate()
 
 bool WaveletAnalyzer::loadCSVFile(const QString &filename)
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    PerfRecorder::Scope scope("load CSV");
+    CSVReader::Data data;
+    try {
+        data = CSVReader::read(QFile::encodeName(filename).constData(), m_transform->threadPool());
+    } catch (const std::exception &e) {
+        qDebug() << "Failed to load" << filename << ":" << e.what();
         return false;
     }
     
-    m_signalData.channels.clear();
-    m_signalData.timeVector.clear();
-    m_signalData.filename = filename;
-    
-    QTextStream in(&file);
-    std::vector<std::vector<double>> tempData;
-    
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        if (line.isEmpty()) continue;
-        
-        std::vector<double> values;
-        parseCSVLine(line, values);
-        
-        if (!values.empty()) {
-            tempData.push_back(values);
-        }
-    }
-    
-    if (tempData.empty()) {
+    if (data.samples() == 0) {
         return false;
     }
+    scope.setItems(static_cast<double>(data.samples()) * data.channels.size());
     
-    int numChannels = tempData[0].size();
-    
-    if (numChannels == 1) {
-        m_signalData.channels.resize(1);
-        
-        for (size_t i = 0; i < tempData.size(); ++i) {
-            double timeValue = static_cast<double>(i) / m_signalData.samplingRate;
-            m_signalData.timeVector.push_back(timeValue);
-            
-            m_signalData.channels[0].push_back(tempData[i][0]);
-        }
-        
-        qDebug() << "Loaded single-column file with" << tempData.size() << "samples";
-        qDebug() << "Generated time vector from 0 to" << m_signalData.timeVector.back() << "seconds";
+    m_signalData.channels.clear();
+    for (auto &channel : data.channels) {
+        m_signalData.channels.emplace_back(std::move(channel));
     }
-    else if (numChannels >= 2) {
-        m_signalData.channels.resize(numChannels - 1);
+    m_signalData.filename = filename;
+    
+    if (data.time.empty()) {
+        size_t samples = m_signalData.channels[0].size();
+        m_signalData.timeVector = SignalColumn::linear(0.0, 1.0 / m_signalData.samplingRate, samples);
         
-        for (const auto &row : tempData) {
-            if (row.size() == numChannels) {
-                m_signalData.timeVector.push_back(row[0]);
-                
-                for (int ch = 1; ch < numChannels; ++ch) {
-                    m_signalData.channels[ch - 1].push_back(row[ch]);
-                }
-            }
-        }
+        qDebug() << "Loaded single-column file with" << samples << "samples";
+        qDebug() << "Generated time vector from 0 to" << m_signalData.timeVector[samples - 1] << "seconds";
+    } else {
+        m_signalData.timeVector = SignalColumn(std::move(data.time));
         
         if (m_signalData.timeVector.size() > 1) {
             double dt = m_signalData.timeVector[1] - m_signalData.timeVector[0];
@@ -341,32 +571,40 @@ bool WaveletAnalyzer::loadCSVFile(const QString &filename)
             qDebug() << "Calculated sampling rate from file:" << m_signalData.samplingRate << "Hz";
         }
         
-        qDebug() << "Loaded multi-column file with" << (numChannels - 1) << "signal channels";
-    }
-    else {
-        qDebug() << "File has no valid data columns";
-        return false;
+        qDebug() << "Loaded multi-column file with" << m_signalData.channels.size() << "signal channels";
     }
     
     m_signalData.selectedChannel = 0;
     return true;
 }
 
-void WaveletAnalyzer::parseCSVLine(const QString &line, std::vector<double> &values)
+bool WaveletAnalyzer::loadBinaryFile(const QString &filename)
 {
-    QStringList parts = line.split(';');
-    if (parts.isEmpty()) {
-        parts = line.split(',');
+    PerfRecorder::Scope scope("load binary");
+    SignalFile::Contents contents;
+    try {
+        contents = SignalFile::read(QFile::encodeName(filename).constData());
+    } catch (const std::exception &e) {
+        qDebug() << "Failed to load" << filename << ":" << e.what();
+        return false;
     }
     
-    values.clear();
-    for (const QString &part : parts) {
-        bool ok;
-        double value = part.trimmed().toDouble(&ok);
-        if (ok) {
-            values.push_back(value);
-        }
+    if (contents.channels.empty() || contents.channels[0].empty() || !(contents.samplingRate > 0.0)) {
+        return false;
     }
+    
+    scope.setItems(static_cast<double>(contents.channels[0].size()) * contents.channels.size());
+    // Channels point into the mapping; nothing is read until it is viewed
+    m_signalData.channels = std::move(contents.channels);
+    m_signalData.samplingRate = contents.samplingRate;
+    m_signalData.timeVector = SignalColumn::linear(contents.timeOrigin, 1.0 / contents.samplingRate,
+                                                   m_signalData.channels[0].size());
+    m_signalData.filename = filename;
+    m_signalData.selectedChannel = 0;
+    
+    qDebug() << "Mapped binary file with" << m_signalData.channels.size() << "channels of"
+             << m_signalData.channels[0].size() << "samples";
+    return true;
 }
 
 void WaveletAnalyzer::updateSignalInfo()
@@ -412,12 +650,28 @@ void WaveletAnalyzer::selectChannel(int channel)
     m_signalData.selectedChannel = channel;
     updatePlots();
     m_statusLabel->setText(QString("Selected channel %1").arg(channel + 1));
+    
+    // A running all-channel job already covers this channel
+    if (m_activeJob && m_activeJob->params.allChannels) {
+        return;
+    }
+    
+    if (channel >= 0 && static_cast<size_t>(channel) < m_channelCoefficients.size()) {
+        m_cwtCoefficients = m_channelCoefficients[channel];
+        m_scalogramPlot->setCWTData(m_cwtCoefficients, m_scales, m_cwtTime);
+    }
+    
+    restartIfRunning();
 }
 
 void WaveletAnalyzer::setSignalParameters()
 {
     m_signalData.samplingRate = m_samplingRateSpinBox->value();
     updatePlots();
+    
+    if (m_live.source) {
+        resetLiveTransform();
+    }
 }
 
 void WaveletAnalyzer::selectWavelet(int waveletType)
@@ -425,6 +679,27 @@ void WaveletAnalyzer::selectWavelet(int waveletType)
     m_cwtParams.waveletType = waveletType;
     QString waveletName = m_waveletCombo->currentText();
     m_statusLabel->setText(QString("Selected %1 wavelet").arg(waveletName));
+    restartIfRunning();
+}
+
+void WaveletAnalyzer::selectEngine(int engine)
+{
+    m_cwtParams.engine = engine;
+    m_statusLabel->setText(QString("Selected %1 engine").arg(m_engineCombo->currentText()));
+    restartIfRunning();
+}
+
+void WaveletAnalyzer::selectSupportTolerance(int index)
+{
+    m_cwtParams.supportTolerance = m_toleranceCombo->itemData(index).toDouble();
+    restartIfRunning();
+}
+
+void WaveletAnalyzer::selectResultType(int resultType)
+{
+    m_cwtParams.resultType = resultType;
+    m_statusLabel->setText(QString("Selected %1 result").arg(m_resultTypeCombo->currentText()));
+    restartIfRunning();
 }
 
 void WaveletAnalyzer::setScaleParameters()
@@ -432,11 +707,17 @@ void WaveletAnalyzer::setScaleParameters()
     m_cwtParams.minScale = m_minScaleSpinBox->value();
     m_cwtParams.maxScale = m_maxScaleSpinBox->value();
     m_cwtParams.scaleSteps = m_scaleStepsSpinBox->value();
+    m_cwtParams.octaveScales = m_scaleSpacingCombo->currentIndex() == 1;
+    m_cwtParams.voicesPerOctave = m_voicesSpinBox->value();
+    m_scaleStepsSpinBox->setEnabled(!m_cwtParams.octaveScales);
+    m_voicesSpinBox->setEnabled(m_cwtParams.octaveScales);
     
     if (m_cwtParams.minScale >= m_cwtParams.maxScale) {
         m_maxScaleSpinBox->setValue(m_cwtParams.minScale + 1);
         m_cwtParams.maxScale = m_cwtParams.minScale + 1;
     }
+    
+    restartIfRunning();
 }
 
 void WaveletAnalyzer::setTimeRange()
@@ -454,8 +735,94 @@ void WaveletAnalyzer::setTimeRange()
                          .arg(m_cwtParams.endSample));
     
     updatePlots();
+    restartIfRunning();
+}
+
+bool WaveletAnalyzer::autoAnalysisEnabled() const
+{
+    // A live source keeps its own scalogram current
+    return m_autoAnalyzeCheckBox->isChecked() && !m_live.source && !m_signalData.channels.empty();
 }
 
+void WaveletAnalyzer::showPreview()
+{
+    if (!autoAnalysisEnabled()) {
+        return;
+    }
+    
+    const auto &fullSignal = m_signalData.channels[m_signalData.selectedChannel];
+    const size_t start = m_cwtParams.startSample;
+    const size_t end = std::min<size_t>(m_cwtParams.endSample, fullSignal.size());
+    if (start >= end) {
+        return;
+    }
+    
+    PerfRecorder::Scope scope("preview");
+    
+    // Whatever the previewed job was doing is out of date now
+    cancelActiveJob();
+    m_analyzeButton->setText("Perform CWT Analysis");
+    m_cancelButton->setEnabled(false);
+    m_progressBar->setValue(0);
+    const auto startTime = std::chrono::steady_clock::now();
+    
+    // Every step samples become one, which shrinks the scales in samples by
+    // the same factor; scales that would fall below the finest the wavelets
+    // resolve are held there
+    const size_t length = end - start;
+    const size_t step = std::max<size_t>(1, length / kPreviewColumns);
+    const size_t columns = length / step;
+    const std::vector<double> grid = scaleGrid(m_cwtParams);
+    const size_t scaleCount = std::min(grid.size(), kPreviewScales);
+    
+    WaveletTransform::Job job;
+    job.engine = WaveletTransform::EngineFFT;
+    job.waveletType = m_cwtParams.waveletType;
+    job.supportTolerance = m_cwtParams.supportTolerance;
+    job.resultType = CoefficientMatrix::MagnitudeFloat;
+    std::vector<double> scales(scaleCount);
+    job.scales.resize(scaleCount);
+    for (size_t i = 0; i < scaleCount; ++i) {
+        scales[i] = grid[scaleCount > 1 ? i * (grid.size() - 1) / (scaleCount - 1) : 0];
+        job.scales[i] = std::max(0.5, scales[i] / step);
+    }
+    
+    // A column is the mean of all its step samples, which keeps content
+    // above the preview's Nyquist rate out of the coarse scales. The plot's
+    // summary tree of the same channel gives each mean from whole cells and
+    // the samples at the edges, so a long range is never read through.
+    const SignalEnvelope &envelope = m_signalPlot->envelope();
+    const bool summarized = envelope.signal().sharesStorage(fullSignal);
+    std::vector<double> time(columns);
+    job.signal.resize(columns);
+    for (size_t column = 0; column < columns; ++column) {
+        const size_t first = start + column * step;
+        const double sum = summarized ? envelope.sum(first, first + step) : fullSignal.sum(first, first + step);
+        job.signal[column] = sum / step;
+        time[column] = m_signalData.timeVector[first + step / 2];
+    }
+    
+    try {
+        m_previewTransform->compute(job);
+    } catch (const std::exception &e) {
+        m_statusLabel->setText(QString("Preview failed: %1").arg(e.what()));
+        return;
+    }
+    
+    m_scalogramPlot->setCWTData(job.coefficients, scales, time);
+    m_previewShown = true;
+    const double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+    m_statusLabel->setText(QString("Preview: %1 scales, 1/%2 time resolution, %3 ms - refining...")
+                          .arg(scaleCount).arg(step).arg(elapsedMs, 0, 'f', 0));
+    
+    // The full run follows once the parameters have settled
+    m_restartTimer->start();
+}
+
+// Widest scalogram overview a streaming job reduces its result to
+static const size_t kOverviewColumns = 8192;
+
 void WaveletAnalyzer::performCWT()
 {
     if (m_signalData.channels.empty() || m_signalData.selectedChannel >= m_signalData.channels.size()) {
@@ -463,225 +830,1139 @@ void WaveletAnalyzer::performCWT()
         return;
     }
     
-    // Disable button during analysis
-    m_analyzeButton->setEnabled(false);
-    m_analyzeButton->setText("Analyzing...");
+    m_restartTimer->stop();
+    m_previewTimer->stop();
     
-    // Reset and show progress
-    m_progressBar->setValue(0);
-    m_progressBar->setVisible(true);
-    m_statusLabel->setText("Starting CWT analysis...");
-    m_infoTextEdit->clear();
+    auto job = prepareAnalysisJob(false);
+    if (job) {
+        job->refinesPreview = m_previewShown;
+        startAnalysisJob(job);
+    }
+}
+
+void WaveletAnalyzer::streamCWTToFile()
+{
+    if (m_signalData.channels.empty() || m_signalData.selectedChannel >= m_signalData.channels.size()) {
+        QMessageBox::warning(this, "Error", "No signal data loaded");
+        return;
+    }
     
-    // Force UI update
-    QApplication::processEvents();
+    const QString rawFilter = "CWT Coefficients (*.mdscwt)";
+    const QString archiveFilter = "Compressed CWT Archive (*.mdscwz)";
+    QString selectedFilter = rawFilter;
+    QString filename = QFileDialog::getSaveFileName(
+        this,
+        "Stream CWT to File",
+        QFileInfo(m_signalData.filename).completeBaseName() + ".mdscwt",
+        rawFilter + ";;" + archiveFilter + ";;All Files (*)",
+        &selectedFilter);
+    if (filename.isEmpty()) {
+        return;
+    }
+    const bool archive = selectedFilter == archiveFilter || filename.endsWith(".mdscwz", Qt::CaseInsensitive);
+    
+    m_restartTimer->stop();
+    
+    auto job = prepareAnalysisJob(true);
+    if (!job) {
+        return;
+    }
     
     try {
-        // Extract signal segment
-        const auto &fullSignal = m_signalData.channels[m_signalData.selectedChannel];
-        
-        // Update parameters from UI
-        m_cwtParams.startSample = m_startSlider->value();
-        m_cwtParams.endSample = m_endSlider->value();
-        m_cwtParams.waveletType = m_waveletCombo->currentIndex();
-        m_cwtParams.minScale = m_minScaleSpinBox->value();
-        m_cwtParams.maxScale = m_maxScaleSpinBox->value();
-        m_cwtParams.scaleSteps = m_scaleStepsSpinBox->value();
-        
-        // Validate range
-        if (m_cwtParams.startSample >= m_cwtParams.endSample) {
-            throw std::runtime_error("Invalid sample range");
+        double timeOrigin = m_signalData.timeVector[job->sourceBegin];
+        if (archive) {
+            job->sinks.push_back(std::make_shared<CoefficientArchiveSink>(
+                QFile::encodeName(filename).constData(), m_signalData.samplingRate, timeOrigin));
+        } else {
+            job->sinks.push_back(std::make_shared<CoefficientFileSink>(
+                QFile::encodeName(filename).constData(), m_signalData.samplingRate, timeOrigin));
         }
-        if (m_cwtParams.endSample > fullSignal.size()) {
-            m_cwtParams.endSample = fullSignal.size();
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString("Failed to create file: %1").arg(e.what()));
+        return;
+    }
+    
+    startAnalysisJob(job);
+}
+
+void WaveletAnalyzer::exportCWTResult()
+{
+    if (!m_cwtCoefficients) {
+        QMessageBox::warning(this, "Error", "No CWT result to export - perform the analysis first");
+        return;
+    }
+    if (m_cwtOverview) {
+        QMessageBox::warning(this, "Error", "A streamed result is only kept as an overview.\n"
+                                            "Use Stream CWT to File to write all of its coefficients.");
+        return;
+    }
+    
+    QString filename = QFileDialog::getSaveFileName(
+        this,
+        "Export CWT Result",
+        QFileInfo(m_signalData.filename).completeBaseName() + ".mdscwz",
+        "Compressed CWT Archive (*.mdscwz);;All Files (*)");
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    // The rate the result was computed at, which the spin box may no longer show
+    double samplingRate = m_signalData.samplingRate;
+    if (m_cwtTime.size() > 1 && m_cwtTime.back() > m_cwtTime.front()) {
+        samplingRate = (m_cwtTime.size() - 1) / (m_cwtTime.back() - m_cwtTime.front());
+    }
+    const double timeOrigin = m_cwtTime.empty() ? 0.0 : m_cwtTime.front();
+    
+    // The preview's pool is idle on the GUI thread, while a running job
+    // may be holding the main one
+    try {
+        CoefficientArchive::write(QFile::encodeName(filename).constData(), *m_cwtCoefficients, m_scales,
+                                  samplingRate, timeOrigin, &m_previewTransform->threadPool());
+    } catch (const std::exception &e) {
+        QMessageBox::warning(this, "Error", QString("Failed to export CWT result: %1").arg(e.what()));
+        m_statusLabel->setText("Failed to export CWT result");
+        return;
+    }
+    
+    const double fileBytes = static_cast<double>(QFileInfo(filename).size());
+    m_statusLabel->setText(QString("Exported %1 (%2 MB, %3:1 compression)")
+                          .arg(QFileInfo(filename).fileName())
+                          .arg(fileBytes / (1024.0 * 1024.0), 0, 'f', 1)
+                          .arg(fileBytes > 0.0 ? m_cwtCoefficients->bytes() / fileBytes : 1.0, 0, 'f', 2));
+}
+
+void WaveletAnalyzer::openCWTResult()
+{
+    QString filename = QFileDialog::getOpenFileName(
+        this,
+        "Open CWT Result",
+        "",
+        "Compressed CWT Archives (*.mdscwz);;All Files (*)");
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    std::unique_ptr<CoefficientArchive> archive;
+    try {
+        archive.reset(new CoefficientArchive(QFile::encodeName(filename).constData()));
+    } catch (const std::exception &e) {
+        QMessageBox::warning(this, "Error", QString("Failed to open CWT result: %1").arg(e.what()));
+        m_statusLabel->setText("Failed to open CWT result");
+        return;
+    }
+    
+    // The scalogram only draws |W|, so that is all that is decoded
+    const CoefficientMatrix::Format format = archive->format();
+    const double magnitudeBytes = static_cast<double>(archive->matrixBytes())
+        / CoefficientMatrix::elementSize(format) * sizeof(float);
+    if (magnitudeBytes > WaveletTransform::kInMemoryResultLimit) {
+        QMessageBox::warning(this, "Error",
+                             QString("%1 holds %2 GB of magnitudes, more than is kept in memory.")
+                             .arg(QFileInfo(filename).fileName())
+                             .arg(magnitudeBytes / (1024.0 * 1024.0 * 1024.0), 0, 'f', 1));
+        return;
+    }
+    
+    stopLiveSource();
+    cancelActiveJob();
+    m_restartTimer->stop();
+    m_previewTimer->stop();
+    
+    const auto startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<CoefficientMatrix> magnitudes;
+    try {
+        magnitudes = archive->readMagnitudes(&m_previewTransform->threadPool());
+    } catch (const std::exception &e) {
+        QMessageBox::warning(this, "Error", QString("Failed to read CWT result: %1").arg(e.what()));
+        m_statusLabel->setText("Failed to read CWT result");
+        return;
+    }
+    const double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+    
+    m_channelCoefficients.clear();
+    m_cwtCoefficients = magnitudes;
+    m_cwtOverview = false;
+    m_previewShown = false;
+    m_scales = archive->scales();
+    m_cwtTime.resize(archive->columns());
+    for (size_t i = 0; i < m_cwtTime.size(); ++i) {
+        m_cwtTime[i] = archive->timeOrigin() + i / archive->samplingRate();
+    }
+    m_scalogramPlot->setCWTData(m_cwtCoefficients, m_scales, m_cwtTime);
+    
+    QString notes;
+    if (magnitudes->isDecimated()) {
+        notes = "  • Decimated: large scales are stored at reduced time resolution\n";
+    }
+    m_infoTextEdit->setText(QString("📂 CWT Result: %1\n\n"
+                                    "  • Result type: %2\n"
+                                    "%3"
+                                    "  • Coefficient Matrix: %4 × %5\n"
+                                    "  • Scales: %6 - %7\n"
+                                    "  • Sampling Rate: %8 Hz, starting at %9 s\n"
+                                    "  • File: %10 MB, %11:1 compression, decoded in %12 ms")
+                            .arg(QFileInfo(filename).fileName())
+                            .arg(resultTypeDescription(format))
+                            .arg(notes)
+                            .arg(m_scales.size())
+                            .arg(archive->columns())
+                            .arg(m_scales.empty() ? 0.0 : m_scales.front())
+                            .arg(m_scales.empty() ? 0.0 : m_scales.back())
+                            .arg(archive->samplingRate(), 0, 'f', 0)
+                            .arg(archive->timeOrigin())
+                            .arg(archive->fileBytes() / (1024.0 * 1024.0), 0, 'f', 1)
+                            .arg(static_cast<double>(archive->matrixBytes()) / archive->fileBytes(), 0, 'f', 2)
+                            .arg(elapsedMs, 0, 'f', 0));
+    m_progressBar->setValue(100);
+    m_statusLabel->setText(QString("Opened %1").arg(QFileInfo(filename).fileName()));
+}
+
+void WaveletAnalyzer::clearResultCache()
+{
+    if (!m_resultStore) {
+        QMessageBox::warning(this, "Error", "No result cache directory is available");
+        return;
+    }
+    
+    const double freedMB = m_resultStore->totalBytes() / (1024.0 * 1024.0);
+    m_resultStore->clear();
+    m_statusLabel->setText(QString("Result cache cleared, %1 MB freed").arg(freedMB, 0, 'f', 1));
+}
+
+std::shared_ptr<WaveletAnalyzer::AnalysisJob> WaveletAnalyzer::prepareAnalysisJob(bool forceStreaming)
+{
+    // Extract signal segment
+    const auto &fullSignal = m_signalData.channels[m_signalData.selectedChannel];
+    
+    // Update parameters from UI
+    m_cwtParams.startSample = m_startSlider->value();
+    m_cwtParams.endSample = m_endSlider->value();
+    m_cwtParams.waveletType = m_waveletCombo->currentIndex();
+    m_cwtParams.engine = m_engineCombo->currentIndex();
+    m_cwtParams.supportTolerance = m_toleranceCombo->currentData().toDouble();
+    m_cwtParams.resultType = m_resultTypeCombo->currentIndex();
+    m_cwtParams.allChannels = m_allChannelsCheckBox->isChecked();
+    m_cwtParams.minScale = m_minScaleSpinBox->value();
+    m_cwtParams.maxScale = m_maxScaleSpinBox->value();
+    m_cwtParams.scaleSteps = m_scaleStepsSpinBox->value();
+    m_cwtParams.octaveScales = m_scaleSpacingCombo->currentIndex() == 1;
+    m_cwtParams.voicesPerOctave = m_voicesSpinBox->value();
+    m_cwtParams.decimate = m_decimateCheckBox->isChecked();
+    
+    // Validate range
+    if (m_cwtParams.endSample > fullSignal.size()) {
+        m_cwtParams.endSample = fullSignal.size();
+    }
+    if (m_cwtParams.startSample >= m_cwtParams.endSample) {
+        QMessageBox::warning(this, "Error", "Invalid sample range");
+        return nullptr;
+    }
+    
+    const size_t start = m_cwtParams.startSample;
+    const size_t end = m_cwtParams.endSample;
+    const size_t length = end - start;
+    
+    const std::vector<double> scales = scaleGrid(m_cwtParams);
+    std::vector<size_t> decimation;
+    if (m_cwtParams.decimate) {
+        decimation = WaveletTransform::decimationSteps(m_cwtParams.waveletType, scales);
+    }
+    // Memory is what decides between in-memory and streaming, so decimated
+    // rows count by the columns they actually keep
+    const double storedRows = WaveletTransform::storedRows(decimation, scales.size());
+    
+    // Every channel's result is kept, so there is no streaming fallback
+    if (m_cwtParams.allChannels && !forceStreaming) {
+        double resultBytes = static_cast<double>(length) * storedRows
+            * m_signalData.channels.size()
+            * CoefficientMatrix::elementSize(static_cast<CoefficientMatrix::Format>(m_cwtParams.resultType));
+        if (resultBytes > WaveletTransform::kInMemoryResultLimit) {
+            QMessageBox::warning(this, "Error",
+                                 QString("All %1 channels would need %2 GB of coefficients.\n"
+                                         "Choose a float result type, fewer scales or a shorter range.")
+                                 .arg(m_signalData.channels.size())
+                                 .arg(resultBytes / (1024.0 * 1024.0 * 1024.0), 0, 'f', 1));
+            return nullptr;
         }
+    }
+    
+    auto job = std::make_shared<AnalysisJob>();
+    job->id = m_nextJobId++;
+    job->setParameters(m_cwtParams);
+    job->engine = forceStreaming ? static_cast<int>(WaveletTransform::EngineStreaming)
+                                 : WaveletTransform::resolveEngine(m_cwtParams.engine, length,
+                                                                   static_cast<size_t>(std::ceil(storedRows)),
+                                                                   m_cwtParams.resultType);
+    
+    if (job->engine == WaveletTransform::EngineStreaming) {
+        // The segment is read block by block from the column itself, and
+        // the scalogram gets one time value per overview column
+        job->source = fullSignal;
+        job->sourceBegin = start;
+        job->sourceEnd = end;
+        job->overview = std::make_shared<ScalogramOverviewSink>(kOverviewColumns);
+        job->sinks.push_back(job->overview);
         
-        std::vector<double> signal(fullSignal.begin() + m_cwtParams.startSample,
-                                  fullSignal.begin() + m_cwtParams.endSample);
-        
-        m_progressBar->setValue(10);
-        m_statusLabel->setText("Preparing scales...");
-        QApplication::processEvents();
-        
-        // Generate scales
-        m_scales.clear();
-        double scaleStep = static_cast<double>(m_cwtParams.maxScale - m_cwtParams.minScale) 
-                          / (m_cwtParams.scaleSteps - 1);
-        
-        for (int i = 0; i < m_cwtParams.scaleSteps; ++i) {
-            m_scales.push_back(m_cwtParams.minScale + i * scaleStep);
+        const size_t columns = std::min(length, kOverviewColumns);
+        job->time.resize(columns);
+        for (size_t j = 0; j < columns; ++j) {
+            job->time[j] = m_signalData.timeVector[start + static_cast<size_t>(
+                (static_cast<unsigned long long>(j) * length + columns - 1) / columns)];
         }
+    } else if (m_cwtParams.allChannels) {
+        job->params.allChannels = true;
+        job->engine = WaveletTransform::EngineFFT;
+        job->displayChannel = m_signalData.selectedChannel;
+        job->channelSignals.resize(m_signalData.channels.size());
+        for (size_t channel = 0; channel < m_signalData.channels.size(); ++channel) {
+            job->channelSignals[channel].resize(length);
+            m_signalData.channels[channel].copy(start, end, job->channelSignals[channel].data());
+        }
+        job->time.resize(length);
+        m_signalData.timeVector.copy(start, end, job->time.data());
+    } else {
+        job->channel = m_signalData.selectedChannel;
+        job->signal.resize(length);
+        fullSignal.copy(start, end, job->signal.data());
+        job->time.resize(length);
+        m_signalData.timeVector.copy(start, end, job->time.data());
         
-        m_progressBar->setValue(20);
-        m_statusLabel->setText("Computing CWT coefficients...");
-        QApplication::processEvents();
-        
-        // Perform CWT with progress updates
-        m_cwtCoefficients = computeCWT(signal, m_scales, m_cwtParams.waveletType);
-        
-        m_progressBar->setValue(80);
-        m_statusLabel->setText("Generating scalogram...");
-        QApplication::processEvents();
-        
-        // Update visualization
-        std::vector<double> timeSegment(m_signalData.timeVector.begin() + m_cwtParams.startSample,
-                                       m_signalData.timeVector.begin() + m_cwtParams.endSample);
-        
-        m_scalogramPlot->setCWTData(m_cwtCoefficients, m_scales, timeSegment);
-        
-        m_progressBar->setValue(90);
-        QApplication::processEvents();
-        
-        // Calculate analysis duration
-        double duration_ms = (m_cwtParams.endSample - m_cwtParams.startSample) * 1000.0 / m_signalData.samplingRate;
-        
-        // Generate detailed analysis info
-        QString info = QString("✅ CWT Analysis Complete\n\n"
-                              "📊 Parameters:\n"
-                              "  • Wavelet: %1\n"
-                              "  • Scales: %2 - %3 (%4 steps)\n"
-                              "  • Samples: %5 - %6 (%7 total)\n"
-                              "  • Duration: %8 ms\n"
-                              "  • Sampling Rate: %9 Hz\n\n"
-                              "📈 Results:\n"
-                              "  • Coefficient Matrix: %10 × %11\n"
-                              "  • Frequency Range: ~%12 - %13 Hz\n\n"
-                              "🎯 Interpretation:\n"
-                              "  • Red/Yellow: High energy\n"
-                              "  • Blue/Green: Low energy\n"
-                              "  • Vertical patterns: Transient events\n"
-                              "  • Horizontal patterns: Sustained activity")
-                      .arg(m_waveletCombo->currentText())
-                      .arg(m_cwtParams.minScale)
-                      .arg(m_cwtParams.maxScale)
-                      .arg(m_cwtParams.scaleSteps)
-                      .arg(m_cwtParams.startSample)
-                      .arg(m_cwtParams.endSample)
-                      .arg(m_cwtParams.endSample - m_cwtParams.startSample)
-                      .arg(duration_ms, 0, 'f', 1)
-                      .arg(m_signalData.samplingRate, 0, 'f', 0)
-                      .arg(m_cwtCoefficients.size())
-                      .arg(m_cwtCoefficients.empty() ? 0 : m_cwtCoefficients[0].size())
-                      .arg(m_signalData.samplingRate / (2 * m_cwtParams.maxScale), 0, 'f', 1)
-                      .arg(m_signalData.samplingRate / (2 * m_cwtParams.minScale), 0, 'f', 1);
-        
-        m_infoTextEdit->setText(info);
-        m_progressBar->setValue(100);
-        m_statusLabel->setText("✅ CWT analysis completed successfully!");
-        
-        // Auto-scroll info to top
-        QTextCursor cursor = m_infoTextEdit->textCursor();
-        cursor.movePosition(QTextCursor::Start);
-        m_infoTextEdit->setTextCursor(cursor);
-        
+        // The transform decides which rows and columns of the channel's
+        // last result still hold
+        auto cached = m_resultCache.find(job->channel);
+        if (cached != m_resultCache.end() && cached->second.waveletType == job->waveletType &&
+            cached->second.engine == job->engine && cached->second.supportTolerance == job->supportTolerance) {
+            cached->second.lastUsed = job->id;
+            job->previous = cached->second.coefficients;
+            job->previousScales = cached->second.scales;
+            job->previousStart = cached->second.start;
+            job->signalStart = start;
+        }
+    }
+    
+    job->scales = scales;
+    if (job->engine != WaveletTransform::EngineStreaming) {
+        job->decimation = decimation;
+    }
+    
+    // Only whole single-channel results of a file are kept on disk
+    if (m_resultStore && !m_signalData.sourcePath.isEmpty() && job->engine != WaveletTransform::EngineStreaming &&
+        !job->params.allChannels) {
+        job->contentHash = m_signalData.contentHash;
+        job->cacheDescription = resultCacheDescription(*job);
+    }
+    
+    return job;
+}
+
+QString WaveletAnalyzer::resultCacheDescription(const AnalysisJob &job) const
+{
+    // Everything the coefficients depend on besides the file's bytes; the
+    // sampling rate only labels the time axis, which is rebuilt from the
+    // signal on a hit
+    QString description = QString("channel %1|samples %2-%3|wavelet %4|engine %5|tolerance %6|result %7|version %8")
+                          .arg(job.channel)
+                          .arg(job.params.startSample)
+                          .arg(job.params.endSample)
+                          .arg(job.waveletType)
+                          .arg(job.engine)
+                          .arg(job.supportTolerance, 0, 'g', 17)
+                          .arg(job.resultType)
+                          .arg(WaveletTransform::kEngineVersion);
+    description += "|scales";
+    for (double scale : job.scales) {
+        description += " " + QString::number(scale, 'g', 17);
+    }
+    description += "|steps";
+    for (size_t step : job.decimation) {
+        description += " " + QString::number(step);
+    }
+    return description;
+}
+
+void WaveletAnalyzer::rememberResult(int channel, const std::shared_ptr<const CoefficientMatrix> &coefficients,
+                                     const AnalysisJob &job)
+{
+    CachedResult &entry = m_resultCache[channel];
+    entry.coefficients = coefficients;
+    entry.scales = job.scales;
+    entry.start = job.params.startSample;
+    entry.waveletType = job.waveletType;
+    entry.engine = job.engine;
+    entry.supportTolerance = job.supportTolerance;
+    entry.lastUsed = job.id;
+    
+    // Evict the least recently used other channels while over the limit
+    for (;;) {
+        double total = 0.0;
+        auto oldest = m_resultCache.end();
+        for (auto it = m_resultCache.begin(); it != m_resultCache.end(); ++it) {
+            total += it->second.coefficients->bytes();
+            if (it->first != channel && (oldest == m_resultCache.end() || it->second.lastUsed < oldest->second.lastUsed)) {
+                oldest = it;
+            }
+        }
+        if (total <= WaveletTransform::kInMemoryResultLimit || oldest == m_resultCache.end()) {
+            break;
+        }
+        m_resultCache.erase(oldest);
+    }
+}
+
+std::vector<double> WaveletAnalyzer::scaleGrid(const CWTParameters &params) const
+{
+    if (params.octaveScales) {
+        return WaveletTransform::octaveGrid(params.minScale, params.maxScale, params.voicesPerOctave);
+    }
+    return WaveletTransform::scaleGrid(params.minScale, params.maxScale, params.scaleSteps);
+}
+
+void WaveletAnalyzer::startAnalysisJob(const std::shared_ptr<AnalysisJob> &job)
+{
+    // A newer request always replaces whatever is still running
+    cancelActiveJob();
+    m_activeJob = job;
+    
+    m_analyzeButton->setText("Restart Analysis");
+    m_cancelButton->setEnabled(true);
+    m_progressBar->setValue(0);
+    m_statusLabel->setText(QString("Computing CWT (%1)...")
+                          .arg(QString::fromStdString(WaveletTransform::engineName(job->engine))));
+    m_infoTextEdit->clear();
+    
+    if (!job->refinesPreview) {
+        m_scalogramPlot->beginCWTData(job->scales, job->time);
+    }
+    
+    // Both run off the GUI thread; rows and progress are handed over through
+    // finishedRows and the queued analysisProgress signal
+    AnalysisJob *target = job.get();
+    const quint64 jobId = job->id;
+    job->progress = [this, jobId]() {
+        emit analysisProgress(jobId);
+    };
+    job->rowFinished = [target](size_t scaleIdx) {
+        std::lock_guard<std::mutex> lock(target->rowsMutex);
+        target->finishedRows.push_back(scaleIdx);
+    };
+    
+    auto *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, job, watcher]() {
+        finishAnalysisJob(job);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([this, job]() {
+        runAnalysisJob(*job);
+    }));
+}
+
+void WaveletAnalyzer::runAnalysisJob(AnalysisJob &job)
+{
+    // Runs on a QThreadPool thread: no widget access from here on.
+    // A result saved earlier for the same bytes and parameters is decoded
+    // instead; an entry that turns out unreadable is dropped and recomputed.
+    // A file that could not be hashed is not cached.
+    if (!job.cacheDescription.isEmpty()) {
+        const QString hash = job.contentHash.result();
+        if (!hash.isEmpty()) {
+            job.cacheKey = ResultCache::makeKey((hash + "|" + job.cacheDescription).toStdString());
+        }
+    }
+    if (!job.cacheKey.empty()) {
+        try {
+            std::unique_ptr<CoefficientArchive> archive = m_resultStore->find(job.cacheKey);
+            if (archive && archive->format() == job.resultType && archive->scales() == job.scales &&
+                archive->columns() == job.signal.size()) {
+                job.coefficients = archive->read(&m_transform->threadPool());
+                job.supportRadius = WaveletTransform::supportRadius(job.waveletType, job.supportTolerance);
+                job.fromCache = true;
+                return;
+            }
+        } catch (const std::exception &) {
+            m_resultStore->remove(job.cacheKey);
+        }
+    }
+    
+    try {
+        m_transform->compute(job);
     } catch (const std::exception &e) {
-        QMessageBox::critical(this, "Error", QString("CWT analysis failed: %1").arg(e.what()));
-        m_statusLabel->setText("❌ CWT analysis failed!");
-        m_progressBar->setValue(0);
-        m_infoTextEdit->setText(QString("❌ Error: %1").arg(e.what()));
+        job.error = QString::fromUtf8(e.what());
+    }
+}
+
+void WaveletAnalyzer::onAnalysisProgress(quint64 jobId)
+{
+    if (!m_activeJob || m_activeJob->id != jobId) {
+        return;
     }
     
-    // Re-enable button
-    m_analyzeButton->setEnabled(true);
-    m_analyzeButton->setText("Perform CWT Analysis");
+    std::vector<size_t> rows;
+    {
+        std::lock_guard<std::mutex> lock(m_activeJob->rowsMutex);
+        rows.swap(m_activeJob->finishedRows);
+    }
+    if (!m_activeJob->refinesPreview) {
+        for (size_t scaleIdx : rows) {
+            m_scalogramPlot->setCWTRow(m_activeJob->coefficients, scaleIdx);
+        }
+    }
+    
+    if (m_activeJob->engine == WaveletTransform::EngineStreaming) {
+        size_t blocks = m_activeJob->completedBlocks;
+        size_t total = m_activeJob->totalBlocks;
+        m_progressBar->setValue(static_cast<int>(blocks * 100 / std::max<size_t>(total, 1)));
+        m_statusLabel->setText(QString("Streaming block %1 of %2...")
+                              .arg(std::min(blocks + 1, std::max<size_t>(total, 1))).arg(total));
+        return;
+    }
+    
+    size_t completed = m_activeJob->completedScales;
+    size_t total = m_activeJob->scales.size() * std::max<size_t>(1, m_activeJob->channelSignals.size());
+    m_progressBar->setValue(static_cast<int>(completed * 100 / std::max<size_t>(total, 1)));
+    m_statusLabel->setText(QString("Computing scales: %1 of %2 done...")
+                          .arg(completed).arg(total));
 }
 
-std::vector<std::vector<std::complex<double>>> WaveletAnalyzer::computeCWT(
-    const std::vector<double> &signal, 
-    const std::vector<double> &scales,
-    int waveletType)
+void WaveletAnalyzer::finishAnalysisJob(const std::shared_ptr<AnalysisJob> &job)
 {
-    std::vector<std::vector<std::complex<double>>> coefficients;
-    coefficients.resize(scales.size());
+    // Results of a replaced job are simply dropped
+    if (job != m_activeJob) {
+        return;
+    }
+    m_activeJob.reset();
+    
+    m_analyzeButton->setText("Perform CWT Analysis");
+    m_cancelButton->setEnabled(false);
+    
+    if (job->cancelRequested) {
+        m_statusLabel->setText("CWT analysis cancelled");
+        m_progressBar->setValue(0);
+        m_infoTextEdit->setText("Analysis cancelled - adjust parameters and run it again");
+        return;
+    }
     
-    int signalLength = signal.size();
-    int totalSteps = scales.size();
+    if (!job->error.isEmpty()) {
+        QMessageBox::critical(this, "Error", QString("CWT analysis failed: %1").arg(job->error));
+        m_statusLabel->setText("❌ CWT analysis failed!");
+        m_progressBar->setValue(0);
+        m_infoTextEdit->setText(QString("❌ Error: %1").arg(job->error));
+        return;
+    }
     
-    for (size_t scaleIdx = 0; scaleIdx < scales.size(); ++scaleIdx) {
-        double scale = scales[scaleIdx];
-        coefficients[scaleIdx].resize(signalLength);
+    const CWTParameters &params = job->params;
+    m_channelCoefficients.clear();
+    m_cwtOverview = job->engine == WaveletTransform::EngineStreaming;
+    if (job->engine == WaveletTransform::EngineStreaming) {
+        m_cwtCoefficients = job->overview->overview();
+    } else if (params.allChannels) {
+        m_channelCoefficients.assign(job->channelCoefficients.begin(), job->channelCoefficients.end());
+        for (size_t channel = 0; channel < m_channelCoefficients.size(); ++channel) {
+            rememberResult(static_cast<int>(channel), m_channelCoefficients[channel], *job);
+        }
+        // The selection may have changed while the job ran
+        size_t channel = std::min<size_t>(std::max(m_signalData.selectedChannel, 0), m_channelCoefficients.size() - 1);
+        m_cwtCoefficients = m_channelCoefficients[channel];
+    } else {
+        m_cwtCoefficients = std::move(job->coefficients);
+        rememberResult(job->channel, m_cwtCoefficients, *job);
         
-        // For each time point
-        for (int t = 0; t < signalLength; ++t) {
-            std::complex<double> coeff(0.0, 0.0);
-            
-            // Convolution with scaled wavelet
-            for (int tau = 0; tau < signalLength; ++tau) {
-                double time = (tau - t) / scale;
-                std::complex<double> waveletValue;
-                
-                switch (waveletType) {
-                    case 0: waveletValue = morletWavelet(time, scale); break;
-                    case 1: waveletValue = mexicanHatWavelet(time, scale); break;
-                    case 2: waveletValue = daubechiesWavelet(time, scale); break;
-                    default: waveletValue = morletWavelet(time, scale); break;
+        // Compressing and writing the entry must not hold up the GUI
+        if (!job->cacheKey.empty() && !job->fromCache) {
+            std::shared_ptr<ResultCache> store = m_resultStore;
+            std::shared_ptr<const CoefficientMatrix> coefficients = m_cwtCoefficients;
+            const std::string key = job->cacheKey;
+            const std::vector<double> scales = job->scales;
+            const double samplingRate = m_signalData.samplingRate;
+            const double timeOrigin = job->time.empty() ? 0.0 : job->time.front();
+            QtConcurrent::run([store, coefficients, key, scales, samplingRate, timeOrigin]() {
+                try {
+                    store->store(key, *coefficients, scales, samplingRate, timeOrigin);
+                } catch (const std::exception &e) {
+                    qDebug() << "Cannot cache CWT result:" << e.what();
                 }
-                
-                coeff += signal[tau] * std::conj(waveletValue);
-            }
-            
-            coefficients[scaleIdx][t] = coeff / std::sqrt(scale);
+            });
         }
-        
-        // Update progress more frequently
-        if (scaleIdx % 5 == 0 || scaleIdx == scales.size() - 1) {
-            int progress = 20 + static_cast<int>((scaleIdx + 1) * 60 / totalSteps);
-            m_progressBar->setValue(progress);
-            m_statusLabel->setText(QString("Computing scale %1 of %2...")
-                                  .arg(scaleIdx + 1).arg(totalSteps));
-            QApplication::processEvents();
+    }
+    m_scales = job->scales;
+    m_cwtTime = job->time;
+    m_previewShown = false;
+    
+    // Update visualization
+    m_scalogramPlot->setCWTData(m_cwtCoefficients, m_scales, m_cwtTime);
+    
+    double resultMB = 0.0;
+    if (m_channelCoefficients.empty()) {
+        resultMB = m_cwtCoefficients->bytes() / (1024.0 * 1024.0);
+    }
+    for (const auto &coefficients : m_channelCoefficients) {
+        resultMB += coefficients->bytes() / (1024.0 * 1024.0);
+    }
+    
+    QString notes;
+    if (job->engine == WaveletTransform::EngineStreaming) {
+        notes = QString("  • Streamed in %1 blocks of %2 samples; scalogram shows a %3-column peak overview\n")
+                .arg(job->totalBlocks.load())
+                .arg(job->blockLength)
+                .arg(m_cwtCoefficients->columns());
+    } else if (params.allChannels) {
+        notes = QString("  • All %1 channels transformed; switch channels to view each result\n")
+                .arg(m_channelCoefficients.size());
+    } else if (job->fromCache) {
+        notes = "  • Loaded from the on-disk result cache (same file and parameters as an earlier run)\n";
+    } else if (job->reusedRows > 0) {
+        notes = QString("  • Incremental: %1 of %2 scales reused from the previous result, %3 edge columns recomputed\n")
+                .arg(job->reusedRows)
+                .arg(job->scales.size())
+                .arg(job->recomputedColumns);
+    }
+    if (m_cwtCoefficients->isDecimated()) {
+        const size_t largestStep = *std::max_element(job->decimation.begin(), job->decimation.end());
+        notes += QString("  • Decimated: large scales stored every 2 - %1 samples, %2% of the full-resolution columns\n")
+                 .arg(largestStep)
+                 .arg(100.0 * WaveletTransform::storedRows(job->decimation, job->scales.size())
+                      / job->scales.size(), 0, 'f', 0);
+    }
+    
+    const QString scaleSpacing = params.octaveScales ? QString("%1 voices/octave").arg(params.voicesPerOctave)
+                                                     : QString("%1 linear steps").arg(params.scaleSteps);
+    
+    // Calculate analysis duration
+    double duration_ms = (params.endSample - params.startSample) * 1000.0 / m_signalData.samplingRate;
+    
+    // Generate detailed analysis info
+    QString info = QString("✅ CWT Analysis Complete\n\n"
+                          "📊 Parameters:\n"
+                          "  • Wavelet: %1\n"
+                          "  • Engine: %14 on %15 threads\n"
+                          "  • Kernel tables: %16 built, %17 reused from cache\n"
+                          "  • Kernel support: ±%18 × scale samples (tolerance %19)\n"
+                          "  • Result type: %20, %21 MB in memory\n"
+                          "%22"
+                          "  • Scales: %2 - %3 (%4)\n"
+                          "  • Samples: %5 - %6 (%7 total)\n"
+                          "  • Duration: %8 ms\n"
+                          "  • Sampling Rate: %9 Hz\n\n"
+                          "📈 Results:\n"
+                          "  • Coefficient Matrix: %10 × %11\n"
+                          "  • Frequency Range: ~%12 - %13 Hz\n\n"
+                          "🎯 Interpretation:\n"
+                          "  • Red/Yellow: High energy\n"
+                          "  • Blue/Green: Low energy\n"
+                          "  • Vertical patterns: Transient events\n"
+                          "  • Horizontal patterns: Sustained activity")
+                  .arg(m_waveletCombo->itemText(params.waveletType))
+                  .arg(params.minScale)
+                  .arg(params.maxScale)
+                  .arg(scaleSpacing)
+                  .arg(params.startSample)
+                  .arg(params.endSample)
+                  .arg(params.endSample - params.startSample)
+                  .arg(duration_ms, 0, 'f', 1)
+                  .arg(m_signalData.samplingRate, 0, 'f', 0)
+                  .arg(job->scales.size())
+                  .arg(params.endSample - params.startSample)
+                  .arg(m_signalData.samplingRate / (2 * params.maxScale), 0, 'f', 1)
+                  .arg(m_signalData.samplingRate / (2 * params.minScale), 0, 'f', 1)
+                  .arg(QString::fromStdString(WaveletTransform::engineName(job->engine)))
+                  .arg(m_transform->threadCount())
+                  .arg(job->kernelsBuilt.load())
+                  .arg(job->scales.size() - std::min(job->scales.size(), job->kernelsBuilt.load()))
+                  .arg(job->supportRadius, 0, 'f', 2)
+                  .arg(m_toleranceCombo->itemText(m_toleranceCombo->findData(params.supportTolerance)))
+                  .arg(resultTypeDescription(params.resultType))
+                  .arg(resultMB, 0, 'f', 1)
+                  .arg(notes);
+    
+    m_infoTextEdit->setText(info);
+    m_progressBar->setValue(100);
+    m_statusLabel->setText("✅ CWT analysis completed successfully!");
+    
+    // Auto-scroll info to top
+    QTextCursor cursor = m_infoTextEdit->textCursor();
+    cursor.movePosition(QTextCursor::Start);
+    m_infoTextEdit->setTextCursor(cursor);
+}
+
+void WaveletAnalyzer::cancelCWT()
+{
+    if (m_activeJob) {
+        // Workers poll the flag between scales and inside long rows
+        m_activeJob->cancelRequested = true;
+        m_cancelButton->setEnabled(false);
+        m_statusLabel->setText("Cancelling CWT analysis...");
+    }
+}
+
+void WaveletAnalyzer::cancelActiveJob()
+{
+    m_restartTimer->stop();
+    if (m_activeJob) {
+        m_activeJob->cancelRequested = true;
+        m_activeJob.reset();
+    }
+}
+
+void WaveletAnalyzer::restartIfRunning()
+{
+    const bool autoAnalysis = autoAnalysisEnabled();
+    if (m_activeJob || autoAnalysis) {
+        m_restartTimer->start();
+    }
+    if (autoAnalysis) {
+        m_previewTimer->start();
+    }
+    
+    // The live transform is cheap to rebuild, so it follows at once
+    if (m_live.source) {
+        resetLiveTransform();
+    }
+}
+
+QString WaveletAnalyzer::resultTypeDescription(int resultType) const
+{
+    switch (resultType) {
+        case CoefficientMatrix::ComplexFloat:
+            return "complex float (phase kept, ~7 significant digits)";
+        case CoefficientMatrix::MagnitudeFloat:
+            return "float magnitude |W| (no phase, ~7 significant digits)";
+        case CoefficientMatrix::PowerFloat:
+            return "float power |W|² (no phase, ~7 significant digits)";
+        default:
+            return "complex double (phase kept, ~15 significant digits)";
+    }
+}
+
+// Seconds of live signal kept, shown and redrawn after a parameter change
+static const double kLiveHistorySeconds = 10.0;
+// Width of the live scalogram; longer histories are max-pooled to fit
+static const size_t kLiveColumns = 2000;
+// Most new samples one live update transforms; more are done in turns
+static const size_t kLiveMaxBlock = 256;
+// Frames moved out of the ring buffer per pop
+static const size_t kLivePopFrames = 4096;
+// Workers of the live transform; a block is a few hundred samples
+static const size_t kLiveThreads = 4;
+// Minimum time between oscillogram and status refreshes
+static const long long kLivePlotIntervalNs = 50000000;
+static const long long kLiveStatusIntervalNs = 500000000;
+
+static long long steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+WaveletAnalyzer::LiveSession::LiveSession()
+    : totalFrames(0), transformed(0), historyLength(0), decimation(1), halfWidth(0),
+      latencySumMs(0.0), latencyMaxMs(0.0), latencyCount(0), framesSinceStatus(0),
+      lastPlotNs(0), lastStatusNs(0)
+{
+}
+
+WaveletAnalyzer::LiveSession::~LiveSession()
+{
+}
+
+void WaveletAnalyzer::openLiveSource()
+{
+    bool ok = false;
+    QString endpoint = QInputDialog::getText(
+        this,
+        "Open Live Source",
+        "Endpoint: - (standard input), tcp://host:port, unix:/path or a named pipe.\n"
+        "One line per frame, channel values separated by ';', ',' or blanks;\n"
+        "samples are taken to arrive at the Sampling Rate set above.",
+        QLineEdit::Normal,
+        "tcp://127.0.0.1:5555",
+        &ok);
+    if (!ok || endpoint.isEmpty()) {
+        return;
+    }
+    
+    stopLiveSource();
+    cancelActiveJob();
+    
+    m_live.recent.clear();
+    m_live.job.reset();
+    m_live.totalFrames = 0;
+    m_live.transformed = 0;
+    m_live.latencySumMs = 0.0;
+    m_live.latencyMaxMs = 0.0;
+    m_live.latencyCount = 0;
+    m_live.framesSinceStatus = 0;
+    m_live.lastPlotNs = 0;
+    m_live.lastStatusNs = steadyNowNs();
+    m_live.source.reset(new LiveSource(endpoint.toStdString()));
+    
+    // The live stream replaces the loaded file
+    m_signalData = SignalData();
+    m_signalData.samplingRate = m_samplingRateSpinBox->value();
+    m_signalData.filename = endpoint;
+    m_cwtCoefficients.reset();
+    m_channelCoefficients.clear();
+    m_resultCache.clear();
+    m_scalogramPlot->setCWTData(nullptr, {}, {});
+    m_fileLabel->setText(QString("Live: %1").arg(endpoint));
+    m_statusLabel->setText("Waiting for live data...");
+    m_infoTextEdit->clear();
+    m_progressBar->setValue(0);
+    
+    m_stopLiveAction->setEnabled(true);
+    m_liveTimer->start();
+}
+
+void WaveletAnalyzer::stopLiveSource()
+{
+    if (!m_live.source) {
+        return;
+    }
+    
+    m_liveTimer->stop();
+    m_stopLiveAction->setEnabled(false);
+    QString error = QString::fromStdString(m_live.source->error());
+    QString endpoint = QString::fromStdString(m_live.source->endpoint());
+    m_live.source.reset();
+    m_live.job.reset();
+    m_live.plan.reset();
+    
+    // What was received stays loaded as an ordinary signal, so the batch
+    // engines can analyse the last seconds in full
+    if (!m_live.recent.empty() && !m_live.recent[0].empty()) {
+        const size_t length = m_live.recent[0].size();
+        const double rate = m_signalData.samplingRate;
+        m_signalData.channels.clear();
+        m_resultCache.clear();
+        for (auto &samples : m_live.recent) {
+            m_signalData.channels.emplace_back(std::move(samples));
         }
+        m_signalData.timeVector = SignalColumn::linear((m_live.totalFrames - length) / rate, 1.0 / rate, length);
+        m_signalData.filename = endpoint;
+        updateSignalInfo();
     }
+    m_live.recent.clear();
     
-    return coefficients;
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "Live Source", QString("Live source failed: %1").arg(error));
+        m_statusLabel->setText("Live source failed");
+    } else {
+        m_statusLabel->setText(QString("Live source closed after %1 frames").arg(m_live.totalFrames));
+    }
 }
 
-std::complex<double> WaveletAnalyzer::morletWavelet(double t, double scale)
+void WaveletAnalyzer::pollLiveSource()
 {
-    const double sigma = 1.0;
-    const double omega0 = 5.0; 
+    LiveSource *source = m_live.source.get();
+    SampleRingBuffer *buffer = source ? source->buffer() : nullptr;
+    if (!buffer) {
+        if (source && source->finished()) {
+            stopLiveSource();
+        }
+        return;
+    }
+    
+    const size_t channels = buffer->channels();
+    if (m_live.recent.size() != channels) {
+        // The first frame fixed the channel count
+        m_live.recent.assign(channels, std::vector<double>());
+        m_channelCombo->clear();
+        for (size_t i = 0; i < channels; ++i) {
+            m_channelCombo->addItem(QString("Channel %1").arg(i + 1));
+        }
+        resetLiveTransform();
+    }
+    
+    // Read before popping, so every frame popped below arrived no later
+    const long long arrivalNs = source->lastArrivalNs();
+    const bool finished = source->finished();
+    
+    size_t received = 0;
+    m_live.frames.resize(kLivePopFrames * channels);
+    while (size_t count = buffer->pop(m_live.frames.data(), kLivePopFrames)) {
+        for (size_t channel = 0; channel < channels; ++channel) {
+            std::vector<double> &samples = m_live.recent[channel];
+            for (size_t i = 0; i < count; ++i) {
+                samples.push_back(m_live.frames[i * channels + channel]);
+            }
+        }
+        received += count;
+    }
+    m_live.totalFrames += received;
+    m_live.framesSinceStatus += received;
+    
+    // Trimmed in batches so the history is not shifted on every update
+    if (m_live.recent[0].size() > 2 * m_live.historyLength) {
+        const size_t excess = m_live.recent[0].size() - m_live.historyLength;
+        for (auto &samples : m_live.recent) {
+            samples.erase(samples.begin(), samples.begin() + excess);
+        }
+    }
+    const size_t historyStart = m_live.totalFrames - m_live.recent[0].size();
+    m_live.transformed = std::max(m_live.transformed, historyStart);
+    
+    while (m_live.transformed < m_live.totalFrames) {
+        const size_t end = std::min(m_live.totalFrames, m_live.transformed + kLiveMaxBlock);
+        size_t firstColumn = 0;
+        size_t columns = computeLiveBlock(m_live.transformed, end, firstColumn);
+        m_scalogramPlot->setLiveColumns(firstColumn, columns, m_live.columnMagnitudes.data());
+        m_live.transformed = end;
+    }
     
-    double envelope = std::exp(-t * t / (2 * sigma * sigma));
-    double oscillation_real = std::cos(omega0 * t);
-    double oscillation_imag = std::sin(omega0 * t);
+    const long long nowNs = steadyNowNs();
+    if (received > 0) {
+        double latencyMs = (nowNs - arrivalNs) / 1e6;
+        m_live.latencySumMs += latencyMs;
+        m_live.latencyMaxMs = std::max(m_live.latencyMaxMs, latencyMs);
+        ++m_live.latencyCount;
+    }
+    
+    const int channel = m_signalData.selectedChannel;
+    if (received > 0 && nowNs - m_live.lastPlotNs >= kLivePlotIntervalNs &&
+        channel >= 0 && static_cast<size_t>(channel) < channels) {
+        const std::vector<double> &samples = m_live.recent[channel];
+        const double rate = m_signalData.samplingRate;
+        m_signalPlot->setSignalData(SignalColumn(samples),
+                                    SignalColumn::linear(historyStart / rate, 1.0 / rate, samples.size()));
+        m_signalPlot->setTimeRange(0, static_cast<int>(samples.size()));
+        m_live.lastPlotNs = nowNs;
+    }
     
-    return std::complex<double>(envelope * oscillation_real, envelope * oscillation_imag);
+    if (nowNs - m_live.lastStatusNs >= kLiveStatusIntervalNs) {
+        double seconds = (nowNs - m_live.lastStatusNs) / 1e9;
+        m_statusLabel->setText(QString("Live: %1 channels, %2 frames/s, latency %3 ms avg / %4 ms max, "
+                                       "%5 dropped, %6 malformed")
+                              .arg(channels)
+                              .arg(m_live.framesSinceStatus / seconds, 0, 'f', 0)
+                              .arg(m_live.latencyCount ? m_live.latencySumMs / m_live.latencyCount : 0.0, 0, 'f', 1)
+                              .arg(m_live.latencyMaxMs, 0, 'f', 1)
+                              .arg(buffer->dropped())
+                              .arg(source->malformedLines()));
+        m_live.latencySumMs = 0.0;
+        m_live.latencyMaxMs = 0.0;
+        m_live.latencyCount = 0;
+        m_live.framesSinceStatus = 0;
+        m_live.lastStatusNs = nowNs;
+    }
+    
+    if (finished && received == 0) {
+        stopLiveSource();
+    }
 }
 
-std::complex<double> WaveletAnalyzer::mexicanHatWavelet(double t, double scale)
+void WaveletAnalyzer::resetLiveTransform()
 {
-    const double sigma = 1.0;
-    double t_norm = t / sigma;
-    double envelope = std::exp(-t_norm * t_norm / 2.0);
-    double poly = 1.0 - t_norm * t_norm;
+    if (!m_live.source || m_live.recent.empty()) {
+        return;
+    }
+    
+    auto job = std::make_shared<AnalysisJob>();
+    job->id = m_nextJobId++;
+    job->setParameters(m_cwtParams);
+    job->engine = WaveletTransform::EngineFFT;
+    job->scales = scaleGrid(m_cwtParams);
+    job->supportRadius = WaveletTransform::supportRadius(m_cwtParams.waveletType, m_cwtParams.supportTolerance);
     
-    return std::complex<double>(envelope * poly, 0.0);
+    double maxScale = 0.0;
+    for (double scale : job->scales) {
+        maxScale = std::max(maxScale, scale);
+    }
+    const size_t halfWidth = std::max<size_t>(1, static_cast<size_t>(std::ceil(job->supportRadius * maxScale)));
+    const double rate = m_signalData.samplingRate;
+    const size_t decimation = std::max<size_t>(
+        1, static_cast<size_t>(std::ceil(kLiveHistorySeconds * rate / kLiveColumns)));
+    
+    // Every update reads halfWidth samples of context before the columns it
+    // redraws, so the history must cover that on top of one full block
+    size_t historyLength = std::max(decimation * kLiveColumns, 2 * halfWidth + kLiveMaxBlock + decimation);
+    historyLength = (historyLength + decimation - 1) / decimation * decimation;
+    
+    if (!m_live.transform) {
+        m_live.transform.reset(new WaveletTransform(kLiveThreads));
+    }
+    m_live.job = job;
+    m_live.halfWidth = halfWidth;
+    m_live.decimation = decimation;
+    m_live.historyLength = historyLength;
+    m_live.plan.reset(new FFTPlan(FFTPlan::nextPowerOfTwo(kLiveMaxBlock + decimation + 3 * halfWidth)));
+    const size_t fftSize = m_live.plan->size();
+    m_live.segment.assign(fftSize, std::complex<double>(0.0, 0.0));
+    m_live.spectrumReal.assign(fftSize, 0.0);
+    m_live.spectrumImag.assign(fftSize, 0.0);
+    m_live.workBuffers.assign(m_live.transform->threadCount(), std::vector<std::complex<double>>());
+    
+    m_scalogramPlot->beginLiveData(job->scales, historyLength / decimation, decimation / rate);
+    
+    // Whatever history is still buffered is redrawn with the new settings
+    const size_t buffered = m_live.recent[0].size();
+    m_live.transformed = m_live.totalFrames - std::min(buffered, historyLength);
 }
 
-std::complex<double> WaveletAnalyzer::daubechiesWavelet(double t, double scale)
+size_t WaveletAnalyzer::computeLiveBlock(size_t begin, size_t end, size_t &firstColumn)
 {
+    const int channel = m_signalData.selectedChannel;
+    if (!m_live.job || channel < 0 || static_cast<size_t>(channel) >= m_live.recent.size()) {
+        firstColumn = 0;
+        return 0;
+    }
     
-    if (std::abs(t) > 3.0) {
-        return std::complex<double>(0.0, 0.0);
+    AnalysisJob &job = *m_live.job;
+    const std::vector<double> &scales = job.scales;
+    const std::vector<double> &samples = m_live.recent[channel];
+    PerfRecorder::Scope scope("live block", static_cast<double>(end - begin) * scales.size());
+    const size_t historyStart = m_live.totalFrames - samples.size();
+    const size_t halfWidth = m_live.halfWidth;
+    const size_t decimation = m_live.decimation;
+    FFTPlan &plan = *m_live.plan;
+    const size_t fftSize = plan.size();
+    
+    // The new samples complete the right-hand context of the halfWidth
+    // samples before them, so those are recomputed as well. Whole columns
+    // are redone, so a column's peak never mixes in stale values.
+    firstColumn = (begin > halfWidth ? begin - halfWidth : 0) / decimation;
+    const size_t outputBegin = std::max(firstColumn * decimation, historyStart);
+    const size_t windowBegin = outputBegin > halfWidth ? outputBegin - halfWidth : 0;
+    const size_t columns = (end - 1) / decimation - firstColumn + 1;
+    
+    // Samples that have not arrived yet count as zero, like the end of a
+    // recording; their columns are redrawn once they do arrive
+    std::fill(m_live.segment.begin(), m_live.segment.end(), std::complex<double>(0.0, 0.0));
+    for (size_t t = std::max(windowBegin, historyStart); t < end; ++t) {
+        m_live.segment[t - windowBegin] = samples[t - historyStart];
+    }
+    plan.forward(m_live.segment.data());
+    for (size_t k = 0; k < fftSize; ++k) {
+        m_live.spectrumReal[k] = m_live.segment[k].real();
+        m_live.spectrumImag[k] = m_live.segment[k].imag();
     }
     
-    const std::vector<double> coeffs = {
-        0.6830127, 1.1830127, 0.3169873, -0.1830127
-    };
+    m_live.columnMagnitudes.assign(scales.size() * columns, 0.0f);
+    const ComplexKernels &kernels = ComplexKernels::instance();
     
-    double value = 0.0;
-    for (size_t i = 0; i < coeffs.size(); ++i) {
-        double x = t + i - 1.5;
-        if (std::abs(x) <= 0.5) {
-            value += coeffs[i];
+    WaveletTransform &transform = *m_live.transform;
+    transform.threadPool().parallelFor(scales.size(), [&](size_t scaleIdx, size_t worker) {
+        auto &work = m_live.workBuffers[worker];
+        WaveletTransform::correlateSpectrum(kernels, *transform.spectrumTable(job, scales[scaleIdx], fftSize),
+                                            m_live.spectrumReal.data(), m_live.spectrumImag.data(),
+                                            work, fftSize);
+        plan.inverse(work.data());
+        
+        float *row = &m_live.columnMagnitudes[scaleIdx * columns];
+        for (size_t t = outputBegin; t < end; ++t) {
+            float magnitude = static_cast<float>(std::abs(work[t - windowBegin]));
+            float &column = row[t / decimation - firstColumn];
+            column = std::max(column, magnitude);
         }
+    });
+    
+    return columns;
+}
+
+void WaveletAnalyzer::showPerformanceStats()
+{
+    if (!m_statsDialog) {
+        m_statsDialog = new QDialog(this);
+        m_statsDialog->setWindowTitle("Performance Stats");
+        m_statsDialog->resize(760, 360);
+        auto *layout = new QVBoxLayout(m_statsDialog);
+        
+        m_statsTextEdit = new QTextEdit;
+        m_statsTextEdit->setReadOnly(true);
+        m_statsTextEdit->setLineWrapMode(QTextEdit::NoWrap);
+        QFont font("Monospace");
+        font.setStyleHint(QFont::TypeWriter);
+        m_statsTextEdit->setFont(font);
+        layout->addWidget(m_statsTextEdit);
+        
+        auto *buttons = new QHBoxLayout;
+        auto *resetButton = new QPushButton("Reset");
+        auto *exportButton = new QPushButton("Export Chrome Trace...");
+        auto *closeButton = new QPushButton("Close");
+        buttons->addWidget(resetButton);
+        buttons->addWidget(exportButton);
+        buttons->addStretch();
+        buttons->addWidget(closeButton);
+        layout->addLayout(buttons);
+        
+        connect(resetButton, &QPushButton::clicked, this, [this]() {
+            PerfRecorder::instance().reset();
+            updatePerformanceStats();
+        });
+        connect(exportButton, &QPushButton::clicked, this, &WaveletAnalyzer::exportPerformanceTrace);
+        connect(closeButton, &QPushButton::clicked, m_statsDialog, &QDialog::close);
+        
+        // Only refreshed while the panel is open
+        m_statsTimer = new QTimer(this);
+        m_statsTimer->setInterval(500);
+        connect(m_statsTimer, &QTimer::timeout, this, &WaveletAnalyzer::updatePerformanceStats);
+        connect(m_statsDialog, &QDialog::finished, m_statsTimer, &QTimer::stop);
+    }
+    
+    updatePerformanceStats();
+    m_statsTimer->start();
+    m_statsDialog->show();
+    m_statsDialog->raise();
+    m_statsDialog->activateWindow();
+}
+
+void WaveletAnalyzer::updatePerformanceStats()
+{
+    if (!m_statsTextEdit) {
+        return;
     }
     
-    return std::complex<double>(value, 0.0);
+    const PerfRecorder &recorder = PerfRecorder::instance();
+    QString text = QString("%1%2%3%4%5%6\n")
+                   .arg("Step", -20)
+                   .arg("Count", 8)
+                   .arg("Last ms", 11)
+                   .arg("Mean ms", 11)
+                   .arg("Max ms", 11)
+                   .arg("M items/s", 12);
+    for (const PerfRecorder::Stat &stat : recorder.stats()) {
+        // Throughput over all runs of the step; steps without items have none
+        const QString throughput = stat.items > 0.0 && stat.totalMs > 0.0
+                                   ? QString::number(stat.items / stat.totalMs / 1e3, 'f', 1) : QString("-");
+        text += QString("%1%2%3%4%5%6\n")
+                .arg(QString::fromStdString(stat.name), -20)
+                .arg(stat.count, 8)
+                .arg(stat.lastMs, 11, 'f', 2)
+                .arg(stat.totalMs / stat.count, 11, 'f', 2)
+                .arg(stat.maxMs, 11, 'f', 2)
+                .arg(throughput, 12);
+    }
+    text += QString("\nItems: samples x scales (x channels) for CWT steps, samples for loading,\n"
+                    "pixels or coefficients for scalogram steps.\n"
+                    "Peak memory: %1 MB, %2 events kept for the trace (up to %3)")
+            .arg(PerfRecorder::peakResidentBytes() / (1024.0 * 1024.0), 0, 'f', 0)
+            .arg(recorder.eventCount())
+            .arg(PerfRecorder::kMaxEvents);
+    m_statsTextEdit->setPlainText(text);
+}
+
+void WaveletAnalyzer::exportPerformanceTrace()
+{
+    QString filename = QFileDialog::getSaveFileName(
+        this,
+        "Export Chrome Trace",
+        "mdsv2_trace.json",
+        "Chrome Trace (*.json);;All Files (*)");
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    try {
+        PerfRecorder::instance().writeChromeTrace(QFile::encodeName(filename).constData());
+    } catch (const std::exception &e) {
+        QMessageBox::critical(this, "Error", QString("Failed to export trace: %1").arg(e.what()));
+        return;
+    }
+    m_statusLabel->setText(QString("Trace written to %1 - open it in chrome://tracing or Perfetto")
+                          .arg(QFileInfo(filename).fileName()));
 }
 
 void WaveletAnalyzer::resetView()
 {
+    cancelActiveJob();
     
     if (!m_signalData.channels.empty()) {
         int maxSamples = m_signalData.channels[0].size();
@@ -691,11 +1972,13 @@ void WaveletAnalyzer::resetView()
     }
     
     
-    m_cwtCoefficients.clear();
+    m_cwtCoefficients.reset();
+    m_channelCoefficients.clear();
+    m_resultCache.clear();
     m_scales.clear();
     
     
-    m_scalogramPlot->setCWTData({}, {}, {});
+    m_scalogramPlot->setCWTData(nullptr, {}, {});
     
     
     m_infoTextEdit->clear();
@@ -709,13 +1992,21 @@ void WaveletAnalyzer::resetView()
     
     
     m_waveletCombo->setCurrentIndex(0); 
-    m_minScaleSpinBox->setValue(1);
-    m_maxScaleSpinBox->setValue(64);
+    m_engineCombo->setCurrentIndex(WaveletTransform::EngineAuto);
+    m_toleranceCombo->setCurrentIndex(2);
+    m_resultTypeCombo->setCurrentIndex(CoefficientMatrix::ComplexDouble);
+    m_allChannelsCheckBox->setChecked(false);
+    m_minScaleSpinBox->setValue(1.0);
+    m_maxScaleSpinBox->setValue(64.0);
+    m_scaleSpacingCombo->setCurrentIndex(0);
     m_scaleStepsSpinBox->setValue(64);
+    m_voicesSpinBox->setValue(12);
+    m_decimateCheckBox->setChecked(false);
     
     
     m_analyzeButton->setEnabled(true);
     m_analyzeButton->setText("Perform CWT Analysis");
+    m_cancelButton->setEnabled(false);
     
     
     updatePlots();
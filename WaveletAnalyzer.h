@@ -13,6 +13,7 @@
 #include <QSpinBox>
 #include <QDoubleSpinBox>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QSlider>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -25,6 +26,7 @@
 #include <QPainter>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QContextMenuEvent>
 #include <QPaintEvent>
 #include <QDesktopWidget>
 #include <QStyleFactory>
@@ -34,6 +36,8 @@
 #include <QStringList>
 #include <QTimer>
 #include <QDebug>
+#include <QFutureWatcher>
+#include <QDialog>
 
 
 #include <vector>
@@ -42,10 +46,25 @@
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "CoefficientMatrix.h"
+#include "CoefficientSinks.h"
+#include "ScalogramImage.h"
+#include "ScalogramPyramid.h"
+#include "SignalColumn.h"
+#include "SignalEnvelope.h"
+#include "WaveletKernelCache.h"
+#include "WaveletTransform.h"
 
 
 class SignalPlotWidget;
 class ScalogramWidget;
+class FFTPlan;
+class LiveSource;
+class ResultCache;
 
 class WaveletAnalyzer : public QMainWindow
 {
@@ -55,15 +74,35 @@ public:
     explicit WaveletAnalyzer(QWidget *parent = nullptr);
     ~WaveletAnalyzer() override;
 
+signals:
+    // Emitted from the analysis thread; connected queued to onAnalysisProgress
+    void analysisProgress(quint64 jobId);
+
 private slots:
     void loadSignalFile();
+    void saveBinaryFile();
+    void streamCWTToFile();
+    void exportCWTResult();
+    void openCWTResult();
+    void clearResultCache();
+    void openLiveSource();
+    void stopLiveSource();
+    void pollLiveSource();
     void selectChannel(int channel);
     void setSignalParameters();
     void selectWavelet(int waveletType);
+    void selectEngine(int engine);
+    void selectSupportTolerance(int index);
+    void selectResultType(int resultType);
     void setScaleParameters();
     void setTimeRange();
     void performCWT();
+    void cancelCWT();
     void resetView();
+    void onAnalysisProgress(quint64 jobId);
+    void showPerformanceStats();
+    void updatePerformanceStats();
+    void exportPerformanceTrace();
 
 private:
     void setupUI();
@@ -76,25 +115,37 @@ private:
     
     
     struct SignalData {
-        std::vector<std::vector<double>> channels;
-        std::vector<double> timeVector;
+        std::vector<SignalColumn> channels;
+        SignalColumn timeVector;
         double samplingRate;
         int selectedChannel;
         QString filename;
+        QString sourcePath;      // file the signal was loaded from; empty for live input
+        QFuture<QString> contentHash;  // ResultCache::fileHash of sourcePath, computed in the background
         
         SignalData() : samplingRate(1000.0), selectedChannel(0) {}
     };
     
     struct CWTParameters {
         int waveletType; 
-        int minScale;
-        int maxScale;
+        int engine;
+        double minScale;
+        double maxScale;
         int scaleSteps;
+        bool octaveScales;       // geometric grid of voicesPerOctave instead of scaleSteps linear steps
+        int voicesPerOctave;
+        bool decimate;           // store large scales at a coarser time step
         int startSample;
         int endSample;
+        double supportTolerance; // fraction of wavelet energy the direct engine may drop
+        int resultType;          // CoefficientMatrix::Format of the stored coefficients
+        bool allChannels;        // transform every channel, not just the selected one
         
-        CWTParameters() : waveletType(0), minScale(1), maxScale(64), 
-                         scaleSteps(64), startSample(0), endSample(1000) {}
+        CWTParameters() : waveletType(0), engine(WaveletTransform::EngineAuto), minScale(1), maxScale(64), 
+                         scaleSteps(64), octaveScales(false), voicesPerOctave(12), decimate(false),
+                         startSample(0), endSample(1000),
+                         supportTolerance(1e-9), resultType(CoefficientMatrix::ComplexDouble),
+                         allChannels(false) {}
     };
     
     
@@ -119,10 +170,19 @@ private:
     
     
     QComboBox *m_waveletCombo;
-    QSpinBox *m_minScaleSpinBox;
-    QSpinBox *m_maxScaleSpinBox;
+    QComboBox *m_engineCombo;
+    QComboBox *m_toleranceCombo;
+    QComboBox *m_resultTypeCombo;
+    QCheckBox *m_allChannelsCheckBox;
+    QDoubleSpinBox *m_minScaleSpinBox;
+    QDoubleSpinBox *m_maxScaleSpinBox;
+    QComboBox *m_scaleSpacingCombo;
     QSpinBox *m_scaleStepsSpinBox;
+    QSpinBox *m_voicesSpinBox;
+    QCheckBox *m_decimateCheckBox;
     QPushButton *m_analyzeButton;
+    QCheckBox *m_autoAnalyzeCheckBox;
+    QPushButton *m_cancelButton;
     QPushButton *m_resetButton;
     
     
@@ -137,18 +197,140 @@ private:
     
     SignalData m_signalData;
     CWTParameters m_cwtParams;
-    std::vector<std::vector<std::complex<double>>> m_cwtCoefficients;
+    std::shared_ptr<const CoefficientMatrix> m_cwtCoefficients;
     std::vector<double> m_scales;
+    std::vector<double> m_cwtTime;
+    bool m_cwtOverview;          // m_cwtCoefficients is a streaming job's peak overview
+    // One matrix per channel after an all-channel run, empty otherwise;
+    // m_cwtCoefficients is the selected channel's entry
+    std::vector<std::shared_ptr<const CoefficientMatrix>> m_channelCoefficients;
+    
+    // Last in-memory result of every channel, so that a run which only
+    // moves the range or the scale bounds recomputes just what changed.
+    // Held while the total stays under the in-memory limit, the least
+    // recently used channel going first.
+    struct CachedResult {
+        std::shared_ptr<const CoefficientMatrix> coefficients;
+        std::vector<double> scales;
+        size_t start;
+        int waveletType;
+        int engine;
+        double supportTolerance;
+        quint64 lastUsed;        // id of the job that produced or reused it
+    };
+    std::map<int, CachedResult> m_resultCache;
+    
+    // Finished single-channel results on disk, keyed by the file's content
+    // and every parameter, so reopening a recording skips the transform;
+    // null if the cache directory cannot be created
+    std::shared_ptr<ResultCache> m_resultStore;
+    
+    // One background CWT run. The GUI thread fills in the inputs and only
+    // reads a coefficient row after its index shows up in finishedRows.
+    struct AnalysisJob : WaveletTransform::Job {
+        quint64 id;
+        int channel;             // channel of a single-channel job
+        CWTParameters params;
+        std::vector<double> time;
+        bool refinesPreview;     // leave the preview up until the whole result is in
+        // A job that may be kept on disk waits for the file's hash on its
+        // worker and combines it with cacheDescription into cacheKey
+        QFuture<QString> contentHash;
+        QString cacheDescription;
+        std::string cacheKey;    // key in m_resultStore; empty when the result is not kept on disk
+        bool fromCache;          // decoded from m_resultStore instead of computed
+        std::mutex rowsMutex;
+        std::vector<size_t> finishedRows;
+        QString error;
+        
+        // Streaming jobs draw this peak overview instead of coefficients
+        std::shared_ptr<ScalogramOverviewSink> overview;
+        
+        AnalysisJob() : id(0), channel(0), refinesPreview(false), fromCache(false) {}
+        
+        void setParameters(const CWTParameters &parameters)
+        {
+            params = parameters;
+            waveletType = parameters.waveletType;
+            supportTolerance = parameters.supportTolerance;
+            resultType = parameters.resultType;
+        }
+    };
+    
+    std::unique_ptr<WaveletTransform> m_transform;
+    std::shared_ptr<AnalysisJob> m_activeJob;
+    quint64 m_nextJobId;
+    QTimer *m_restartTimer;
+    
+    // Auto-analysis: a parameter change first draws a coarse preview on the
+    // GUI thread, from a box-averaged signal and a subset of the scales,
+    // with a transform of its own so that a job still winding down cannot
+    // hold it up; the full-resolution job replaces it when done
+    std::unique_ptr<WaveletTransform> m_previewTransform;
+    QTimer *m_previewTimer;
+    bool m_previewShown;
+    
+    // Live input. The source's thread fills a ring buffer; m_liveTimer
+    // drains it on the GUI thread and extends the transform by the new
+    // samples only, revising the columns whose right-hand context arrived.
+    // Blocks run on a transform of their own, so a background job winding
+    // down cannot hold up a redraw.
+    struct LiveSession {
+        std::unique_ptr<LiveSource> source;
+        std::unique_ptr<WaveletTransform> transform;
+        std::shared_ptr<AnalysisJob> job;        // wavelet, scales and kernel statistics
+        std::vector<std::vector<double>> recent; // newest samples of every channel
+        std::vector<double> frames;              // interleaved scratch for the ring buffer
+        size_t totalFrames;                      // frames received since the source opened
+        size_t transformed;                      // frames whose columns have been drawn
+        size_t historyLength;                    // frames kept and shown
+        size_t decimation;                       // samples per scalogram column
+        size_t halfWidth;                        // widest kernel's half-width in samples
+        std::unique_ptr<FFTPlan> plan;
+        std::vector<std::complex<double>> segment;
+        std::vector<double> spectrumReal;
+        std::vector<double> spectrumImag;
+        std::vector<std::vector<std::complex<double>>> workBuffers;
+        std::vector<float> columnMagnitudes;     // scales x columns of the last update
+        double latencySumMs;
+        double latencyMaxMs;
+        size_t latencyCount;
+        size_t framesSinceStatus;
+        long long lastPlotNs;
+        long long lastStatusNs;
+        
+        LiveSession();
+        ~LiveSession();
+    };
+    LiveSession m_live;
+    QTimer *m_liveTimer;
+    QAction *m_stopLiveAction;
+    
+    // View -> Performance Stats: PerfRecorder totals, refreshed while shown
+    QDialog *m_statsDialog;
+    QTextEdit *m_statsTextEdit;
+    QTimer *m_statsTimer;
+    
+    void resetLiveTransform();
+    size_t computeLiveBlock(size_t begin, size_t end, size_t &firstColumn);
+    
+    std::vector<double> scaleGrid(const CWTParameters &params) const;
+    std::shared_ptr<AnalysisJob> prepareAnalysisJob(bool forceStreaming);
+    void startAnalysisJob(const std::shared_ptr<AnalysisJob> &job);
+    void runAnalysisJob(AnalysisJob &job);
+    void finishAnalysisJob(const std::shared_ptr<AnalysisJob> &job);
+    QString resultCacheDescription(const AnalysisJob &job) const;
+    void rememberResult(int channel, const std::shared_ptr<const CoefficientMatrix> &coefficients,
+                        const AnalysisJob &job);
+    void cancelActiveJob();
+    void restartIfRunning();
+    bool autoAnalysisEnabled() const;
+    void showPreview();
     
     void detectAndSetSamplingRate();
     bool loadCSVFile(const QString &filename);
-    void parseCSVLine(const QString &line, std::vector<double> &values);
-    std::vector<std::vector<std::complex<double>>> computeCWT(const std::vector<double> &signal, 
-                                                 const std::vector<double> &scales,
-                                                 int waveletType);
-    std::complex<double> morletWavelet(double t, double scale);
-    std::complex<double> mexicanHatWavelet(double t, double scale);
-    std::complex<double> daubechiesWavelet(double t, double scale);
+    bool loadBinaryFile(const QString &filename);
+    QString resultTypeDescription(int resultType) const;
 };
 
 
@@ -157,8 +339,10 @@ class SignalPlotWidget : public QWidget
     Q_OBJECT
 public:
     explicit SignalPlotWidget(QWidget *parent = nullptr);
-    void setSignalData(const std::vector<double> &signal, const std::vector<double> &time);
+    void setSignalData(const SignalColumn &signal, const SignalColumn &time);
     void setTimeRange(int start, int end);
+    // Summary of the shown signal
+    const SignalEnvelope &envelope() const { return m_envelope; }
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -166,13 +350,20 @@ protected:
     void wheelEvent(QWheelEvent *event) override;
 
 private:
-    std::vector<double> m_signal;
-    std::vector<double> m_time;
+    SignalColumn m_signal;
+    SignalColumn m_time;
     int m_startIndex;
     int m_endIndex;
     double m_zoomFactor;
     QPoint m_lastPanPoint;
     
+    // Min/max tree of m_signal, and the extrema of the shown range that
+    // both the axes and the trace are scaled to
+    SignalEnvelope m_envelope;
+    double m_rangeMin;
+    double m_rangeMax;
+    
+    void updateRangeExtrema();
     void drawSignal(QPainter &painter);
     void drawGrid(QPainter &painter);
     void drawAxes(QPainter &painter);
@@ -183,22 +374,69 @@ class ScalogramWidget : public QWidget
     Q_OBJECT
 public:
     explicit ScalogramWidget(QWidget *parent = nullptr);
-    void setCWTData(const std::vector<std::vector<std::complex<double>>> &coefficients,
+    // The matrix is shared with the analyzer, not copied
+    void setCWTData(const std::shared_ptr<const CoefficientMatrix> &coefficients,
                     const std::vector<double> &scales,
                     const std::vector<double> &time);
+    
+    // Progressive display: rows are drawn as they arrive, blank until then.
+    // setCWTRow marks one finished row of the job's matrix as readable.
+    void beginCWTData(const std::vector<double> &scales, const std::vector<double> &time);
+    void setCWTRow(const std::shared_ptr<const CoefficientMatrix> &coefficients, size_t scaleIdx);
+    
+    // Live display: a fixed number of columns that scrolls left as new ones
+    // arrive. Columns are numbered from the start of the stream and may be
+    // sent again when later samples refine them; magnitudes holds
+    // scales x count values, one row of count per scale.
+    void beginLiveData(const std::vector<double> &scales, size_t columns, double secondsPerColumn);
+    void setLiveColumns(size_t firstColumn, size_t count, const float *magnitudes);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
 
 private:
-    std::vector<std::vector<std::complex<double>>> m_coefficients;
     std::vector<double> m_scales;
     std::vector<double> m_time;
+    
+    // Analysis results are drawn from a pyramid of pooled magnitudes into
+    // an image exactly as wide as the plot, holding only the visible
+    // columns; it is redrawn when the view, the size or the data change
+    ScalogramPyramid m_pyramid;
+    ScalogramPyramid::Pooling m_pooling;
+    QImage m_viewImage;
+    bool m_viewDirty;
+    double m_viewFirstColumn;
+    double m_viewColumns;
+    std::vector<float> m_pixelMagnitudes;
+    bool m_panning;
+    QPoint m_lastPanPoint;
+    
+    // Colour map and scaling come from the context menu; the palette is
+    // rebuilt when they or the largest |W| change
+    ScalogramImage::Colormap m_colormap;
+    ScalogramImage::Scaling m_scaling;
+    ScalogramImage::Palette m_palette;
+    
+    // Live results scroll through an image with one pixel per column
     QImage m_scalogramImage;
+    double m_maxMagnitude;
+    bool m_live;
+    size_t m_liveFirstColumn;
+    double m_secondsPerColumn;
     
-    void generateScalogramImage();
-    QColor valueToColor(double magnitude, double maxMagnitude);
+    QRect plotArea() const;
+    void resetZoom();
+    void clampView();
+    void renderView(int width);
+    void renderViewRow(size_t scaleIdx);
+    // True when the palette had to be rebuilt
+    bool updatePalette(double maxMagnitude);
     void drawColorScale(QPainter &painter);
 };
 
@@ -0,0 +1,95 @@
+#include "WaveletKernelCache.h"
+#include <tuple>
+
+bool WaveletKernelCache::Key::operator<(const Key &other) const
+{
+    return std::tie(domain, waveletType, scale, length)
+         < std::tie(other.domain, other.waveletType, other.scale, other.length);
+}
+
+WaveletKernelCache::WaveletKernelCache(size_t maxBytes)
+    : m_maxBytes(maxBytes)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+std::shared_ptr<const WaveletKernelCache::Table> WaveletKernelCache::table(
+    Domain domain, int waveletType, double scale, size_t length, const Builder &build)
+{
+    const Key key = {domain, waveletType, scale, length};
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+            ++m_hits;
+            return it->second.table;
+        }
+        ++m_misses;
+    }
+    
+    // Build outside the lock so workers on other scales are not serialized.
+    // Two workers racing on the same key both build; the first insert wins.
+    auto table = std::make_shared<Table>();
+    build(*table);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        return it->second.table;
+    }
+    
+    m_lru.push_front(key);
+    m_entries[key] = Entry{table, m_lru.begin()};
+    m_bytes += table->bytes();
+    evictLocked();
+    
+    return table;
+}
+
+void WaveletKernelCache::evictLocked()
+{
+    // Always keep the newest table, even if it alone exceeds the budget
+    while (m_bytes > m_maxBytes && m_lru.size() > 1) {
+        auto it = m_entries.find(m_lru.back());
+        m_bytes -= it->second.table->bytes();
+        m_entries.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+void WaveletKernelCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+size_t WaveletKernelCache::memoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+size_t WaveletKernelCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t WaveletKernelCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+void WaveletKernelCache::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hits = 0;
+    m_misses = 0;
+}
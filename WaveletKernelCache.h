@@ -0,0 +1,78 @@
+#ifndef WAVELETKERNELCACHE_H
+#define WAVELETKERNELCACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+// Sampled wavelet tables shared by all CWT runs, keyed by
+// (domain, wavelet type, scale, length) and evicted least-recently-used
+// once the byte budget is exceeded. Safe to use from pool workers.
+class WaveletKernelCache
+{
+public:
+    enum Domain {
+        // Entry i is the kernel tap for offset m = i - origin
+        TimeDomain = 0,
+        // Entry i is the spectrum at bin (origin + i) % length; other bins are zero
+        FrequencyDomain = 1
+    };
+    
+    // Values are stored split into real and imaginary arrays (SoA) so the
+    // SIMD kernels can load them directly
+    struct Table {
+        size_t origin;
+        std::vector<double> real;
+        std::vector<double> imag;
+        
+        Table() : origin(0) {}
+        size_t size() const { return real.size(); }
+        size_t bytes() const { return (real.size() + imag.size()) * sizeof(double); }
+    };
+    
+    using Builder = std::function<void(Table &table)>;
+    
+    explicit WaveletKernelCache(size_t maxBytes = size_t(256) << 20);
+    
+    // Returns the cached table, building it with build() on a miss
+    std::shared_ptr<const Table> table(Domain domain, int waveletType, double scale,
+                                       size_t length, const Builder &build);
+    
+    void clear();
+    size_t memoryUsage() const;
+    size_t hits() const;
+    size_t misses() const;
+    void resetStatistics();
+
+private:
+    struct Key {
+        int domain;
+        int waveletType;
+        double scale;
+        size_t length;
+        
+        bool operator<(const Key &other) const;
+    };
+    
+    struct Entry {
+        std::shared_ptr<const Table> table;
+        std::list<Key>::iterator lruPosition;
+    };
+    
+    void evictLocked();
+    
+    mutable std::mutex m_mutex;
+    std::map<Key, Entry> m_entries;
+    std::list<Key> m_lru;
+    size_t m_maxBytes;
+    size_t m_bytes;
+    size_t m_hits;
+    size_t m_misses;
+};
+
+#endif
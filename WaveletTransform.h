@@ -0,0 +1,206 @@
+#ifndef WAVELETTRANSFORM_H
+#define WAVELETTRANSFORM_H
+
+#include "CoefficientMatrix.h"
+#include "CoefficientSinks.h"
+#include "SignalColumn.h"
+#include "WaveletKernelCache.h"
+
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ComplexKernels;
+class ThreadPool;
+
+
+// The continuous wavelet transform engines, without any GUI dependency.
+// The analyzer window runs them on a background thread and the headless
+// mode runs them directly; both share the kernel table cache.
+class WaveletTransform
+{
+public:
+    enum Engine {
+        EngineAuto = 0,
+        EngineDirect = 1,
+        EngineFFT = 2,
+        EngineStreaming = 3
+    };
+    
+    enum WaveletType {
+        Morlet = 0,
+        MexicanHat = 1,
+        Daubechies = 2
+    };
+    
+    // Largest result the in-memory engines are allowed to allocate
+    static constexpr double kInMemoryResultLimit = 2.0 * 1024 * 1024 * 1024;
+    
+    // Raised whenever a change alters computed coefficients, so results
+    // saved by an older build are not taken for current ones
+    static const int kEngineVersion = 1;
+    
+    // One CWT run. The caller fills in the inputs; compute() writes the
+    // results and counters, which other threads may poll while it runs.
+    struct Job {
+        int engine;              // resolved Engine, never EngineAuto
+        int waveletType;
+        double supportTolerance; // fraction of wavelet energy the kernels may drop
+        int resultType;          // CoefficientMatrix::Format of the stored coefficients
+        std::vector<double> signal;
+        std::vector<double> scales;
+        // Optional, one per scale: the in-memory engines compute and store
+        // only every decimation[i]-th column of row i (see decimationSteps).
+        // Streaming jobs always produce full-resolution tiles.
+        std::vector<size_t> decimation;
+        double supportRadius;
+        
+        std::shared_ptr<CoefficientMatrix> coefficients;
+        std::atomic<bool> cancelRequested;
+        std::atomic<size_t> completedScales;
+        std::atomic<size_t> kernelsBuilt;
+        
+        // Streaming jobs read [sourceBegin, sourceEnd) straight from the
+        // channel block by block and hand coefficient tiles to the sinks;
+        // signal and coefficients stay empty
+        SignalColumn source;
+        size_t sourceBegin;
+        size_t sourceEnd;
+        std::vector<std::shared_ptr<CoefficientSink>> sinks;
+        std::atomic<size_t> completedBlocks;
+        std::atomic<size_t> totalBlocks;
+        size_t blockLength;
+        
+        // Jobs with channelSignals transform every entry instead of signal;
+        // coefficients is the displayChannel entry, filled while it runs
+        std::vector<std::vector<double>> channelSignals;
+        std::vector<std::shared_ptr<CoefficientMatrix>> channelCoefficients;
+        size_t displayChannel;
+        
+        // Optional, for in-memory single-signal jobs: an earlier result of
+        // the same signal, wavelet, tolerance and result type. signal starts
+        // at sample signalStart, previous column 0 was sample previousStart.
+        // Rows whose scale and step match keep every column whose kernel
+        // read the same samples in both runs; only the other scales and the
+        // columns near a range edge that moved are computed.
+        std::shared_ptr<const CoefficientMatrix> previous;
+        std::vector<double> previousScales;
+        size_t previousStart;
+        size_t signalStart;
+        // Rows taken over from previous, and the columns of each of them
+        // that were recomputed near the range edges
+        size_t reusedRows;
+        size_t recomputedColumns;
+        
+        // Both optional. progress is called on the computing thread every
+        // 100 ms or so; rowFinished on a pool worker once a row of
+        // coefficients is final and may be read.
+        std::function<void()> progress;
+        std::function<void(size_t)> rowFinished;
+        
+        Job();
+        virtual ~Job();
+    };
+    
+    // Settings of the one-call transform()
+    struct Settings {
+        int waveletType;
+        int engine;              // EngineAuto, EngineDirect or EngineFFT
+        int resultType;          // CoefficientMatrix::Format of the result
+        double supportTolerance;
+        bool decimate;           // store each scale at the coarsest step its band allows
+        
+        Settings() : waveletType(Morlet), engine(EngineAuto), resultType(CoefficientMatrix::ComplexDouble),
+                     supportTolerance(1e-9), decimate(false) {}
+    };
+    
+    // threadCount 0 uses every hardware thread. Transforms sharing a cache
+    // reuse each other's kernel tables.
+    explicit WaveletTransform(size_t threadCount = 0,
+                              std::shared_ptr<WaveletKernelCache> cache = nullptr);
+    ~WaveletTransform();
+    
+    WaveletTransform(const WaveletTransform &) = delete;
+    WaveletTransform &operator=(const WaveletTransform &) = delete;
+    
+    ThreadPool &threadPool() const { return *m_threadPool; }
+    size_t threadCount() const;
+    
+    // Runs the job to completion on the pool. Throws on failure; returns
+    // early, with partial results, once cancelRequested is set. Timed in
+    // PerfRecorder as "CWT <engine>", signal length x scales x channels
+    // items.
+    void compute(Job &job);
+    
+    // Signal in, coefficients out: a scales.size() x signal.size() matrix.
+    // progress, if set, is called on the calling thread with the fraction
+    // of scales done. EngineStreaming has no in-memory result and throws
+    // std::invalid_argument; stream through compute() and sinks instead.
+    std::shared_ptr<CoefficientMatrix> transform(std::vector<double> signal, const std::vector<double> &scales,
+                                                 const Settings &settings = Settings(),
+                                                 const std::function<void(double)> &progress = std::function<void(double)>());
+    
+    // scaleSteps scales spaced evenly from minScale to maxScale
+    static std::vector<double> scaleGrid(double minScale, double maxScale, int scaleSteps);
+    // voicesPerOctave scales per doubling, geometrically spaced from
+    // minScale up to maxScale (included when it falls on the grid)
+    static std::vector<double> octaveGrid(double minScale, double maxScale, int voicesPerOctave);
+    
+    // Per-scale output step: the largest power of two that still samples
+    // the wavelet's pass band above its Nyquist rate. Large scales are
+    // smooth in time and need only a fraction of the columns.
+    static std::vector<size_t> decimationSteps(int waveletType, const std::vector<double> &scales);
+    // Full-resolution rows' worth of coefficients in a decimated result
+    static double storedRows(const std::vector<size_t> &decimation, size_t scaleCount);
+    
+    // Picks the engine EngineAuto stands for
+    static int resolveEngine(int engine, size_t signalLength, size_t scaleCount, int resultType);
+    static std::string engineName(int engine);
+    
+    // Half-width, in samples at unit scale, of the kernels built for tolerance
+    static double supportRadius(int waveletType, double tolerance);
+    
+    // Cached conj(wavelet spectrum) band for one scale and FFT size
+    std::shared_ptr<const WaveletKernelCache::Table> spectrumTable(Job &job, double scale, size_t fftSize);
+    
+    // Writes spectrum x conj(wavelet spectrum) into work
+    static void correlateSpectrum(const ComplexKernels &kernels, const WaveletKernelCache::Table &band,
+                                  const double *spectrumReal, const double *spectrumImag,
+                                  std::vector<std::complex<double>> &work, size_t fftSize);
+
+private:
+    void computeJob(Job &job);
+    void computeDirect(Job &job);
+    void computeFFT(Job &job);
+    void computeStreaming(Job &job);
+    void computeAllChannels(Job &job);
+    bool computeIncremental(Job &job);
+    void computePart(Job &job, size_t begin, size_t end, const std::vector<size_t> &rows,
+                     const std::function<void(const CoefficientMatrix &, size_t, size_t)> &rowDone);
+    static std::shared_ptr<CoefficientMatrix> createResult(const Job &job, size_t signalLength);
+    static void reportProgress(Job &job);
+    static void finishScaleRow(Job &job, size_t scaleIdx);
+    std::shared_ptr<const WaveletKernelCache::Table> kernelTable(Job &job, double scale);
+    static void buildKernelTable(int waveletType, double scale, size_t halfLength,
+                                 WaveletKernelCache::Table &table);
+    static void buildSpectrumTable(int waveletType, double scale, size_t fftSize,
+                                   WaveletKernelCache::Table &table);
+    static std::complex<double> morletWavelet(double t, double scale);
+    static std::complex<double> mexicanHatWavelet(double t, double scale);
+    static std::complex<double> daubechiesWavelet(double t, double scale);
+    
+    // Spectra of the sampled kernels psi(n / scale), including aliasing,
+    // so the FFT engine reproduces the direct convolution
+    static std::complex<double> morletSpectrum(double omega, double scale);
+    static std::complex<double> mexicanHatSpectrum(double omega, double scale);
+    static std::complex<double> daubechiesSpectrum(double omega, double scale);
+    
+    std::unique_ptr<ThreadPool> m_threadPool;
+    std::shared_ptr<WaveletKernelCache> m_kernelCache;
+};
+
+#endif
@@ -0,0 +1,558 @@
+// Performance suite for the CWT engines, the CSV loader, the oscillogram
+// envelope, the scalogram pyramid and scalogram image generation. Every case is repeated until it has run for at least
+// --min-time seconds, Google Benchmark style; the first run is reported
+// separately as cold_ms, since it also builds the kernel tables.
+//
+//   mdsv2_bench [--filter regex] [--min-time s] [--quick] [--threads n]
+//               [--result-type complex-double|complex-float|magnitude|power]
+//               [--csv file]... [--out results.json]
+//
+// A table goes to stderr as the cases finish; the JSON report, in Google
+// Benchmark's format so its compare tooling reads it, goes to stdout or
+// --out. Names are <group>/<variant>/<parameters>, e.g.
+// cwt/fft/morlet/n=100000/scales=64, so --filter selects whole groups.
+
+#include "CSVReader.h"
+#include "CoefficientMatrix.h"
+#include "CoefficientSinks.h"
+#include "ComplexKernels.h"
+#include "FFTPlan.h"
+#include "ScalogramPyramid.h"
+#include "SignalColumn.h"
+#include "SignalEnvelope.h"
+#include "ThreadPool.h"
+#include "WaveletTransform.h"
+
+#ifdef MDSV2_BENCH_SCALOGRAM
+#include "ScalogramImage.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const double kPi = 3.14159265358979323846;
+
+struct Options {
+    std::regex filter{".*"};
+    double minSeconds = 0.5;
+    bool quick = false;
+    size_t threads = 0;
+    int resultType = CoefficientMatrix::ComplexDouble;
+    std::vector<std::string> csvFiles;
+    std::string outPath;
+};
+
+struct Result {
+    std::string name;
+    size_t iterations = 0;
+    double realMs = 0.0;   // mean wall time per iteration
+    double cpuMs = 0.0;    // mean process CPU time per iteration, all threads
+    double minMs = 0.0;
+    double coldMs = 0.0;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+// Accepts every tile and keeps nothing, so streaming cases time the engine alone
+class DiscardSink : public CoefficientSink
+{
+public:
+    void begin(const std::vector<double> &, size_t) override {}
+    void consumeTile(const CoefficientMatrix &, size_t, size_t) override {}
+};
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: mdsv2_bench [--filter regex] [--min-time s] [--quick] [--threads n]\n"
+                         "                   [--result-type complex-double|complex-float|magnitude|power]\n"
+                         "                   [--csv file]... [--out results.json]\n");
+    std::exit(2);
+}
+
+static Options parseOptions(int argc, char **argv)
+{
+    static const char *resultTypes[] = {"complex-double", "complex-float", "magnitude", "power"};
+    
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--quick") {
+            options.quick = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+        }
+        std::string value = argv[++i];
+        if (option == "--filter") {
+            options.filter = std::regex(value);
+        } else if (option == "--min-time") {
+            options.minSeconds = std::atof(value.c_str());
+        } else if (option == "--threads") {
+            options.threads = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--result-type") {
+            auto found = std::find(std::begin(resultTypes), std::end(resultTypes), value);
+            if (found == std::end(resultTypes)) {
+                usage();
+            }
+            options.resultType = static_cast<int>(found - std::begin(resultTypes));
+        } else if (option == "--csv") {
+            options.csvFiles.push_back(value);
+        } else if (option == "--out") {
+            options.outPath = value;
+        } else {
+            usage();
+        }
+    }
+    return options;
+}
+
+template <typename Function>
+static Result measure(const std::string &name, double minSeconds, Function function)
+{
+    Result result;
+    result.name = name;
+    
+    auto start = Clock::now();
+    function();
+    result.coldMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    
+    double totalMs = 0.0;
+    double best = 1e300;
+    const std::clock_t cpuStart = std::clock();
+    while (result.iterations == 0 || totalMs < minSeconds * 1000.0) {
+        start = Clock::now();
+        function();
+        double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        totalMs += elapsed;
+        best = std::min(best, elapsed);
+        ++result.iterations;
+    }
+    const double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    
+    result.realMs = totalMs / result.iterations;
+    result.cpuMs = cpuMs / result.iterations;
+    result.minMs = best;
+    return result;
+}
+
+static void report(std::vector<Result> &results, Result result)
+{
+    std::fprintf(stderr, "%-52s %10.3f ms %10.3f ms cpu %6zu it", result.name.c_str(), result.realMs,
+                 result.cpuMs, result.iterations);
+    for (const auto &counter : result.counters) {
+        std::fprintf(stderr, "  %s=%.4g", counter.first.c_str(), counter.second);
+    }
+    std::fprintf(stderr, "\n");
+    results.push_back(std::move(result));
+}
+
+// Chirp sweeping most of the scale range plus noise, so every scale does
+// representative work
+static std::vector<double> testSignal(size_t length)
+{
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise(0.0, 0.1);
+    std::vector<double> signal(length);
+    for (size_t i = 0; i < length; ++i) {
+        double t = static_cast<double>(i) / static_cast<double>(length);
+        signal[i] = std::sin(2.0 * kPi * (0.002 + 0.2 * t) * static_cast<double>(i)) + noise(random);
+    }
+    return signal;
+}
+
+static void benchmarkCWT(const Options &options, WaveletTransform &transform, std::vector<Result> &results)
+{
+    static const char *engineNames[] = {"auto", "direct", "fft", "streaming"};
+    static const char *waveletNames[] = {"morlet", "mexican-hat", "daubechies"};
+    
+    std::vector<size_t> lengths = {1000, 10000, 100000, 1000000};
+    std::vector<int> scaleCounts = {10, 64, 256};
+    if (options.quick) {
+        lengths.pop_back();
+    }
+    const auto format = static_cast<CoefficientMatrix::Format>(options.resultType);
+    
+    for (size_t length : lengths) {
+        const std::vector<double> signal = testSignal(length);
+        const SignalColumn column{std::vector<double>(signal)};
+        
+        for (int engine : {WaveletTransform::EngineDirect, WaveletTransform::EngineFFT,
+                           WaveletTransform::EngineStreaming}) {
+            // The direct engine is O(N x kernel length) per scale; past 10k
+            // samples it only measures how slow it is. Streaming only pays
+            // off once there is more than one block.
+            if ((engine == WaveletTransform::EngineDirect && length > 10000) ||
+                (engine == WaveletTransform::EngineStreaming && length < 100000)) {
+                continue;
+            }
+            
+            for (int wavelet = 0; wavelet < 3; ++wavelet) {
+                for (int scaleCount : scaleCounts) {
+                    const std::string name = std::string("cwt/") + engineNames[engine] + "/" + waveletNames[wavelet]
+                        + "/n=" + std::to_string(length) + "/scales=" + std::to_string(scaleCount);
+                    if (!std::regex_search(name, options.filter)) {
+                        continue;
+                    }
+                    const double resultBytes = static_cast<double>(length) * scaleCount
+                        * CoefficientMatrix::elementSize(format);
+                    if (engine != WaveletTransform::EngineStreaming &&
+                        resultBytes > WaveletTransform::kInMemoryResultLimit) {
+                        std::fprintf(stderr, "%-52s skipped: %.1f GB result\n", name.c_str(), resultBytes / 1e9);
+                        continue;
+                    }
+                    
+                    const std::vector<double> scales = WaveletTransform::scaleGrid(1, 128, scaleCount);
+                    size_t kernelsBuilt = 0;
+                    Result result = measure(name, options.minSeconds, [&]() {
+                        // Set up as the GUI does, including the copy of the segment
+                        WaveletTransform::Job job;
+                        job.engine = engine;
+                        job.waveletType = wavelet;
+                        job.resultType = options.resultType;
+                        job.scales = scales;
+                        if (engine == WaveletTransform::EngineStreaming) {
+                            job.source = column;
+                            job.sourceBegin = 0;
+                            job.sourceEnd = length;
+                            job.sinks.push_back(std::make_shared<DiscardSink>());
+                        } else {
+                            job.signal = signal;
+                        }
+                        transform.compute(job);
+                        kernelsBuilt += job.kernelsBuilt;
+                    });
+                    
+                    const double seconds = result.realMs / 1000.0;
+                    result.counters.emplace_back("samples_per_second", length / seconds);
+                    result.counters.emplace_back("coefficients_per_second", length * scaleCount / seconds);
+                    result.counters.emplace_back("kernels_built", static_cast<double>(kernelsBuilt));
+                    report(results, std::move(result));
+                }
+            }
+        }
+    }
+}
+
+static void writeSyntheticCSV(const std::string &path, size_t rows, size_t channels)
+{
+    std::mt19937 random(3);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::ofstream out(path);
+    out << "time";
+    for (size_t channel = 0; channel < channels; ++channel) {
+        out << ";channel" << channel + 1;
+    }
+    out << "\n";
+    
+    char field[32];
+    for (size_t row = 0; row < rows; ++row) {
+        std::snprintf(field, sizeof(field), "%.4f", row * 0.001);
+        out << field;
+        for (size_t channel = 0; channel < channels; ++channel) {
+            std::snprintf(field, sizeof(field), ";%.6f", noise(random));
+            out << field;
+        }
+        out << "\n";
+    }
+}
+
+static void benchmarkCSVFile(const Options &options, ThreadPool &pool, const std::string &name,
+                             const std::string &path, std::vector<Result> &results)
+{
+    if (!std::regex_search(name, options.filter)) {
+        return;
+    }
+    
+    size_t samples = 0;
+    Result result = measure(name, options.minSeconds, [&]() {
+        samples = CSVReader::read(path, pool).samples();
+    });
+    const double bytes = static_cast<double>(std::filesystem::file_size(path));
+    const double seconds = result.realMs / 1000.0;
+    result.counters.emplace_back("bytes_per_second", bytes / seconds);
+    result.counters.emplace_back("rows_per_second", samples / seconds);
+    report(results, std::move(result));
+}
+
+static void benchmarkCSV(const Options &options, ThreadPool &pool, std::vector<Result> &results)
+{
+    std::vector<size_t> rowCounts = {100000, 1000000};
+    if (options.quick) {
+        rowCounts.pop_back();
+    }
+    
+    const size_t channels = 4;
+    for (size_t rows : rowCounts) {
+        const std::string name = "csv/load/rows=" + std::to_string(rows) + "/channels=" + std::to_string(channels);
+        if (!std::regex_search(name, options.filter)) {
+            continue;
+        }
+        const std::string path = (std::filesystem::temp_directory_path()
+                                  / ("mdsv2_bench_" + std::to_string(rows) + ".csv")).string();
+        writeSyntheticCSV(path, rows, channels);
+        benchmarkCSVFile(options, pool, name, path, results);
+        std::filesystem::remove(path);
+    }
+    
+    for (const std::string &path : options.csvFiles) {
+        benchmarkCSVFile(options, pool, "csv/load/file=" + std::filesystem::path(path).filename().string(),
+                         path, results);
+    }
+}
+
+static void benchmarkEnvelope(const Options &options, std::vector<Result> &results)
+{
+    // Building the min/max tree of a long channel, then redrawing a 1600
+    // pixel wide oscillogram of all of it
+    const size_t samples = options.quick ? 1000000 : 10000000;
+    const size_t pixels = 1600;
+    const std::string buildName = "signal/envelope-build/n=" + std::to_string(samples);
+    const std::string viewName = "signal/envelope-view/n=" + std::to_string(samples) + "/pixels="
+        + std::to_string(pixels);
+    if (!std::regex_search(buildName, options.filter) && !std::regex_search(viewName, options.filter)) {
+        return;
+    }
+    
+    std::vector<double> values(samples);
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise;
+    for (double &value : values) {
+        value = noise(random);
+    }
+    const SignalColumn signal(std::move(values));
+    
+    SignalEnvelope envelope;
+    if (std::regex_search(buildName, options.filter)) {
+        Result result = measure(buildName, options.minSeconds, [&]() {
+            envelope.build(signal);
+        });
+        result.counters.emplace_back("bytes", static_cast<double>(envelope.bytes()));
+        report(results, std::move(result));
+    }
+    envelope.build(signal);
+    
+    if (std::regex_search(viewName, options.filter)) {
+        std::vector<double> minima(pixels);
+        std::vector<double> maxima(pixels);
+        Result result = measure(viewName, options.minSeconds, [&]() {
+            if (envelope.envelope(0.0, static_cast<double>(samples) / pixels, pixels, minima.data(),
+                                  maxima.data()) != pixels) {
+                std::abort();
+            }
+        });
+        result.counters.emplace_back("frames_per_second", 1000.0 / result.realMs);
+        report(results, std::move(result));
+    }
+}
+
+static void benchmarkPyramid(const Options &options, std::vector<Result> &results)
+{
+    // A long recording: building the pyramid once, then redrawing a
+    // 1600 pixel wide view at full extent and zoomed 100x
+    const size_t scales = 64;
+    const size_t columns = options.quick ? 200000 : 1000000;
+    const size_t pixels = 1600;
+    const std::string suffix = "/scales=" + std::to_string(scales) + "/columns=" + std::to_string(columns);
+    
+    const std::string buildName = "scalogram/pyramid-build" + suffix;
+    const std::string fullName = "scalogram/pyramid-view/zoom=1" + suffix;
+    const std::string zoomName = "scalogram/pyramid-view/zoom=100" + suffix;
+    if (!std::regex_search(buildName, options.filter) && !std::regex_search(fullName, options.filter)
+        && !std::regex_search(zoomName, options.filter)) {
+        return;
+    }
+    
+    auto magnitudes = std::make_shared<CoefficientMatrix>(scales, columns, CoefficientMatrix::MagnitudeFloat);
+    std::mt19937 random(6);
+    std::uniform_real_distribution<float> magnitude(0.0f, 1.0f);
+    for (size_t row = 0; row < scales; ++row) {
+        for (float &value : magnitudes->row<float>(row)) {
+            value = magnitude(random);
+        }
+    }
+    
+    ScalogramPyramid pyramid;
+    if (std::regex_search(buildName, options.filter)) {
+        Result result = measure(buildName, options.minSeconds, [&]() {
+            pyramid.build(magnitudes);
+        });
+        result.counters.emplace_back("bytes", static_cast<double>(pyramid.bytes()));
+        report(results, std::move(result));
+    }
+    pyramid.build(magnitudes);
+    
+    std::vector<float> line(pixels);
+    const std::vector<std::pair<std::string, double>> views = {{fullName, 1.0}, {zoomName, 100.0}};
+    for (const auto &view : views) {
+        if (!std::regex_search(view.first, options.filter)) {
+            continue;
+        }
+        const double visible = columns / view.second;
+        const double first = (columns - visible) / 2;
+        Result result = measure(view.first, options.minSeconds, [&]() {
+            for (size_t row = 0; row < scales; ++row) {
+                pyramid.sample(row, first, visible / pixels, pixels, ScalogramPyramid::Peak, line.data());
+            }
+        });
+        result.counters.emplace_back("frames_per_second", 1000.0 / result.realMs);
+        report(results, std::move(result));
+    }
+}
+
+static void benchmarkScalogram(const Options &options, ThreadPool &pool, std::vector<Result> &results)
+{
+    benchmarkPyramid(options, results);
+    
+#ifdef MDSV2_BENCH_SCALOGRAM
+    // The overview a streaming job draws, and full-resolution in-memory results
+    const std::vector<std::pair<size_t, size_t>> sizes = {{256, 8192}, {64, 10000}, {128, 100000}};
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> magnitude(0.0f, 1.0f);
+    
+    for (const auto &size : sizes) {
+        const std::string suffix = "/scales=" + std::to_string(size.first) + "/columns=" + std::to_string(size.second);
+        if (!std::regex_search("scalogram/render/linear" + suffix, options.filter)
+            && !std::regex_search("scalogram/render/db" + suffix, options.filter)) {
+            continue;
+        }
+        CoefficientMatrix magnitudes(size.first, size.second, CoefficientMatrix::MagnitudeFloat);
+        for (size_t row = 0; row < magnitudes.rows(); ++row) {
+            for (float &value : magnitudes.row<float>(row)) {
+                value = magnitude(random);
+            }
+        }
+        
+        for (int scaling = ScalogramImage::Linear; scaling <= ScalogramImage::Decibel; ++scaling) {
+            const std::string name = std::string("scalogram/render/")
+                + (scaling == ScalogramImage::Decibel ? "db" : "linear") + suffix;
+            if (!std::regex_search(name, options.filter)) {
+                continue;
+            }
+            Result result = measure(name, options.minSeconds, [&]() {
+                QImage image = ScalogramImage::render(magnitudes, ScalogramImage::Viridis,
+                                                      static_cast<ScalogramImage::Scaling>(scaling),
+                                                      ScalogramImage::kDefaultDynamicRangeDb, &pool);
+                if (image.isNull()) {
+                    std::abort();
+                }
+            });
+            result.counters.emplace_back("pixels_per_second", size.first * size.second / (result.realMs / 1000.0));
+            report(results, std::move(result));
+        }
+    }
+#else
+    (void)pool;
+    std::fprintf(stderr, "scalogram/render skipped: built without Qt (MDSV2_BUILD_GUI=OFF)\n");
+#endif
+}
+
+static std::string jsonString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+static void writeJSON(std::FILE *out, const Options &options, size_t threads, const std::vector<Result> &results)
+{
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    static const char *resultTypes[] = {"complex-double", "complex-float", "magnitude", "power"};
+    
+    std::fprintf(out, "{\n  \"context\": {\n");
+    std::fprintf(out, "    \"date\": %s,\n", jsonString(date).c_str());
+    std::fprintf(out, "    \"executable\": \"mdsv2_bench\",\n");
+    std::fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(out, "    \"threads\": %zu,\n", threads);
+    std::fprintf(out, "    \"fft_backend\": %s,\n", jsonString(FFTPlan::backendName()).c_str());
+    std::fprintf(out, "    \"simd_kernels\": %s,\n", jsonString(ComplexKernels::instance().name).c_str());
+    std::fprintf(out, "    \"result_type\": %s,\n", jsonString(resultTypes[options.resultType]).c_str());
+#ifdef NDEBUG
+    std::fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+    std::fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+    std::fprintf(out, "  },\n  \"benchmarks\": [\n");
+    
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        std::fprintf(out, "    {\n");
+        std::fprintf(out, "      \"name\": %s,\n", jsonString(result.name).c_str());
+        std::fprintf(out, "      \"run_name\": %s,\n", jsonString(result.name).c_str());
+        std::fprintf(out, "      \"run_type\": \"iteration\",\n");
+        std::fprintf(out, "      \"iterations\": %zu,\n", result.iterations);
+        std::fprintf(out, "      \"real_time\": %.6f,\n", result.realMs);
+        std::fprintf(out, "      \"cpu_time\": %.6f,\n", result.cpuMs);
+        std::fprintf(out, "      \"time_unit\": \"ms\",\n");
+        std::fprintf(out, "      \"min_ms\": %.6f,\n", result.minMs);
+        std::fprintf(out, "      \"cold_ms\": %.6f", result.coldMs);
+        for (const auto &counter : result.counters) {
+            std::fprintf(out, ",\n      %s: %.6g", jsonString(counter.first).c_str(), counter.second);
+        }
+        std::fprintf(out, "\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+    Options options = parseOptions(argc, argv);
+    if (options.quick) {
+        options.minSeconds = std::min(options.minSeconds, 0.1);
+    }
+    
+    WaveletTransform transform(options.threads);
+    std::fprintf(stderr, "mdsv2_bench: %zu threads, FFT %s, kernels %s\n\n", transform.threadCount(),
+                 FFTPlan::backendName(), ComplexKernels::instance().name);
+    
+    std::vector<Result> results;
+    try {
+        benchmarkCWT(options, transform, results);
+        benchmarkCSV(options, transform.threadPool(), results);
+        benchmarkEnvelope(options, results);
+        benchmarkScalogram(options, transform.threadPool(), results);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "mdsv2_bench: %s\n", e.what());
+        return 1;
+    }
+    
+    std::FILE *out = stdout;
+    if (!options.outPath.empty()) {
+        out = std::fopen(options.outPath.c_str(), "w");
+        if (!out) {
+            std::perror(options.outPath.c_str());
+            return 1;
+        }
+    }
+    writeJSON(out, options, transform.threadCount(), results);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
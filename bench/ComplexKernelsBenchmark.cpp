@@ -0,0 +1,135 @@
+// Micro-benchmark for the CWT inner loops: the interleaved std::complex loop
+// the engines used before, the portable SoA kernel and the dispatched one.
+//
+//   mdsv2_kernel_bench [taps] [bins]
+
+#include "ComplexKernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimizer from discarding the benchmarked work
+static volatile double g_sink;
+
+template <typename Function>
+static double bestNanoseconds(size_t repetitions, Function function)
+{
+    double best = 1e300;
+    for (int round = 0; round < 5; ++round) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < repetitions; ++i) {
+            function();
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        best = std::min(best, elapsed / static_cast<double>(repetitions));
+    }
+    return best;
+}
+
+static void benchmarkDot(size_t taps)
+{
+    // One output sample of the direct engine: signal window times kernel taps
+    std::vector<double> signal(taps);
+    std::vector<std::complex<double>> interleaved(taps);
+    std::vector<double> real(taps);
+    std::vector<double> imag(taps);
+    for (size_t i = 0; i < taps; ++i) {
+        signal[i] = std::sin(0.37 * static_cast<double>(i));
+        interleaved[i] = std::polar(std::exp(-1e-4 * static_cast<double>(i)), 0.11 * static_cast<double>(i));
+        real[i] = interleaved[i].real();
+        imag[i] = interleaved[i].imag();
+    }
+    
+    const size_t repetitions = std::max<size_t>(1, (size_t(1) << 26) / taps);
+    
+    double reference = bestNanoseconds(repetitions, [&]() {
+        double coeffReal = 0.0;
+        double coeffImag = 0.0;
+        for (size_t m = 0; m < taps; ++m) {
+            coeffReal += signal[m] * interleaved[m].real();
+            coeffImag += signal[m] * interleaved[m].imag();
+        }
+        g_sink = coeffReal + coeffImag;
+    });
+    
+    auto timeKernels = [&](const ComplexKernels &kernels) {
+        return bestNanoseconds(repetitions, [&]() {
+            double coeffReal;
+            double coeffImag;
+            kernels.realComplexDot(signal.data(), real.data(), imag.data(), taps, &coeffReal, &coeffImag);
+            g_sink = coeffReal + coeffImag;
+        });
+    };
+    double scalar = timeKernels(ComplexKernels::scalar());
+    double dispatched = timeKernels(ComplexKernels::instance());
+    
+    std::printf("direct dot, %zu taps:\n", taps);
+    std::printf("  interleaved loop   %10.1f ns\n", reference);
+    std::printf("  SoA scalar         %10.1f ns  (%.2fx)\n", scalar, reference / scalar);
+    std::printf("  SoA %-14s %10.1f ns  (%.2fx)\n", ComplexKernels::instance().name, dispatched, reference / dispatched);
+}
+
+static void benchmarkMultiply(size_t bins)
+{
+    // One scale of the FFT engine: signal spectrum times the cached band
+    std::vector<std::complex<double>> spectrum(bins);
+    std::vector<std::complex<double>> band(bins);
+    std::vector<double> spectrumReal(bins);
+    std::vector<double> spectrumImag(bins);
+    std::vector<double> bandReal(bins);
+    std::vector<double> bandImag(bins);
+    std::vector<std::complex<double>> out(bins);
+    for (size_t k = 0; k < bins; ++k) {
+        spectrum[k] = std::complex<double>(std::cos(0.01 * static_cast<double>(k)), std::sin(0.03 * static_cast<double>(k)));
+        band[k] = std::polar(1.0 / (1.0 + static_cast<double>(k)), 0.2 * static_cast<double>(k));
+        spectrumReal[k] = spectrum[k].real();
+        spectrumImag[k] = spectrum[k].imag();
+        bandReal[k] = band[k].real();
+        bandImag[k] = band[k].imag();
+    }
+    
+    const size_t repetitions = std::max<size_t>(1, (size_t(1) << 26) / bins);
+    
+    double reference = bestNanoseconds(repetitions, [&]() {
+        for (size_t k = 0; k < bins; ++k) {
+            out[k] = spectrum[k] * band[k];
+        }
+        g_sink = out[bins / 2].real();
+    });
+    
+    auto timeKernels = [&](const ComplexKernels &kernels) {
+        return bestNanoseconds(repetitions, [&]() {
+            kernels.multiply(spectrumReal.data(), spectrumImag.data(), bandReal.data(), bandImag.data(),
+                             out.data(), bins);
+            g_sink = out[bins / 2].real();
+        });
+    };
+    double scalar = timeKernels(ComplexKernels::scalar());
+    double dispatched = timeKernels(ComplexKernels::instance());
+    
+    std::printf("spectrum multiply, %zu bins:\n", bins);
+    std::printf("  interleaved loop   %10.1f ns\n", reference);
+    std::printf("  SoA scalar         %10.1f ns  (%.2fx)\n", scalar, reference / scalar);
+    std::printf("  SoA %-14s %10.1f ns  (%.2fx)\n", ComplexKernels::instance().name, dispatched, reference / dispatched);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t taps = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+    size_t bins = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 65536;
+    if (taps == 0 || bins == 0) {
+        std::fprintf(stderr, "usage: %s [taps] [bins]\n", argv[0]);
+        return 1;
+    }
+    
+    std::printf("Selected kernels: %s\n\n", ComplexKernels::instance().name);
+    benchmarkDot(taps);
+    std::printf("\n");
+    benchmarkMultiply(bins);
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Test generator for the live input: streams a synthetic multi-channel
+// signal in real time, one text line per frame, in the format LiveSource
+// reads. Every channel carries its own tone plus a short burst every two
+// seconds, so the scrolling scalogram shows whether columns keep up.
+//
+//   mdsv2_live_gen [--rate Hz] [--channels n] [--seconds s]
+//                  [--tcp port | --unix path]
+//
+// Without --tcp or --unix the frames go to standard output, e.g. into a
+// named pipe. The socket modes listen on 127.0.0.1 or the given path and
+// serve one client at a time.
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static const double kPi = 3.14159265358979323846;
+
+struct Options {
+    double rate = 2000.0;
+    int channels = 16;
+    double seconds = 0.0;
+    int tcpPort = 0;
+    std::string unixPath;
+};
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: mdsv2_live_gen [--rate Hz] [--channels n] [--seconds s] "
+                         "[--tcp port | --unix path]\n");
+    std::exit(2);
+}
+
+static Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+        }
+        const char *value = argv[++i];
+        if (option == "--rate") {
+            options.rate = std::atof(value);
+        } else if (option == "--channels") {
+            options.channels = std::atoi(value);
+        } else if (option == "--seconds") {
+            options.seconds = std::atof(value);
+        } else if (option == "--tcp") {
+            options.tcpPort = std::atoi(value);
+        } else if (option == "--unix") {
+            options.unixPath = value;
+        } else {
+            usage();
+        }
+    }
+    if (options.rate <= 0.0 || options.channels <= 0) {
+        usage();
+    }
+    return options;
+}
+
+static int listenAndAccept(const Options &options)
+{
+    int server;
+    if (options.tcpPort > 0) {
+        server = ::socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        ::setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(options.tcpPort));
+        if (::bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            std::perror("bind");
+            std::exit(1);
+        }
+    } else {
+        server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.unixPath.c_str(), sizeof(address.sun_path) - 1);
+        ::unlink(options.unixPath.c_str());
+        if (::bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            std::perror("bind");
+            std::exit(1);
+        }
+    }
+    
+    ::listen(server, 1);
+    std::fprintf(stderr, "Waiting for a client...\n");
+    int client = ::accept(server, nullptr, nullptr);
+    ::close(server);
+    if (client < 0) {
+        std::perror("accept");
+        std::exit(1);
+    }
+    return client;
+}
+
+static bool writeAll(int fd, const std::string &text)
+{
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t count = ::write(fd, text.data() + written, text.size() - written);
+        if (count <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    const bool socketMode = options.tcpPort > 0 || !options.unixPath.empty();
+    const int fd = socketMode ? listenAndAccept(options) : STDOUT_FILENO;
+    
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0.0, 0.05);
+    std::string text;
+    char number[32];
+    
+    // Frames are written in 1 ms batches, on schedule against the clock
+    const auto start = Clock::now();
+    const auto batch = std::chrono::milliseconds(1);
+    unsigned long long frame = 0;
+    for (auto deadline = start; ; deadline += batch) {
+        std::this_thread::sleep_until(deadline);
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (options.seconds > 0.0 && elapsed >= options.seconds) {
+            break;
+        }
+        
+        const unsigned long long due = static_cast<unsigned long long>(elapsed * options.rate);
+        text.clear();
+        for (; frame < due; ++frame) {
+            const double t = frame / options.rate;
+            const double phase = std::fmod(t, 2.0);
+            const double burst = phase < 0.04 ? std::sin(2.0 * kPi * 150.0 * t) * std::sin(kPi * phase / 0.04) : 0.0;
+            for (int channel = 0; channel < options.channels; ++channel) {
+                double tone = 2.0 + 3.0 * channel;
+                double value = std::sin(2.0 * kPi * tone * t) + 2.0 * burst + noise(random);
+                std::snprintf(number, sizeof(number), channel ? ";%.5f" : "%.5f", value);
+                text += number;
+            }
+            text += '\n';
+        }
+        if (!text.empty() && !writeAll(fd, text)) {
+            break;
+        }
+    }
+    
+    if (fd != STDOUT_FILENO) {
+        ::close(fd);
+    }
+    return 0;
+}
@@ -4,9 +4,18 @@
 #include <QIcon>
 #include <QDebug>
 #include "WaveletAnalyzer.h"
+#include "HeadlessRunner.h"
 
 int main(int argc, char *argv[])
 {
+    // Batch runs never create a widget, so they work without a display
+    if (HeadlessRunner::requested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        app.setApplicationName("mdsv2");
+        app.setApplicationVersion("2.0");
+        return HeadlessRunner::run(app);
+    }
+    
     QApplication app(argc, argv);
     
     
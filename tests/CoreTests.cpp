@@ -0,0 +1,376 @@
+// Correctness checks for mdsv2_core: engine agreement, incremental reuse,
+// the coefficient archive, the signal envelope and the CSV loader.
+//
+//   mdsv2_tests [case]...
+//
+// Runs the named cases, or all of them. A failed check is reported on
+// stderr and the exit code is non-zero; ctest runs every case on its own.
+
+#include "CSVReader.h"
+#include "CoefficientArchive.h"
+#include "CoefficientMatrix.h"
+#include "SignalColumn.h"
+#include "SignalEnvelope.h"
+#include "ThreadPool.h"
+#include "WaveletTransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const double kPi = 3.14159265358979323846;
+
+// Kernel energy the engines may drop. Truncating a kernel changes the
+// coefficients by about the square root of that, relative to the largest,
+// which bounds how far two ways of computing the same result may differ.
+static const double kTolerance = 1e-12;
+static const double kMaxError = 4.0 * std::sqrt(kTolerance);
+
+static int s_failures = 0;
+
+#define CHECK(condition, ...)                                                       \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            std::fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #condition); \
+            std::fprintf(stderr, __VA_ARGS__);                                      \
+            std::fprintf(stderr, "\n");                                             \
+            ++s_failures;                                                           \
+        }                                                                           \
+    } while (false)
+
+// Two tones, a chirp and noise, so every scale of the grids below sees
+// some energy
+static std::vector<double> testSignal(size_t length, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0.0, 0.2);
+    std::vector<double> signal(length);
+    for (size_t i = 0; i < length; ++i) {
+        const double t = static_cast<double>(i);
+        signal[i] = std::sin(2.0 * kPi * 0.01 * t) + 0.5 * std::sin(2.0 * kPi * 0.13 * t)
+                    + std::sin(2.0 * kPi * (0.001 + 0.1 * t / length) * t) + noise(random);
+    }
+    return signal;
+}
+
+// Largest |a - b| over all coefficients, relative to the largest |a|
+static double relativeError(const CoefficientMatrix &a, const CoefficientMatrix &b)
+{
+    double largest = 0.0;
+    double error = 0.0;
+    for (size_t row = 0; row < a.rows(); ++row) {
+        const auto rowA = a.row(row);
+        const auto rowB = b.row(row);
+        for (size_t column = 0; column < rowA.size(); ++column) {
+            largest = std::max(largest, std::abs(rowA[column]));
+            error = std::max(error, std::abs(rowA[column] - rowB[column]));
+        }
+    }
+    return largest > 0.0 ? error / largest : error;
+}
+
+static std::string temporaryPath(const std::string &name)
+{
+    return (fs::temp_directory_path() / ("mdsv2_tests_" + name)).string();
+}
+
+// The FFT engine's spectra include the aliasing of the sampled kernels, so
+// it must reproduce the direct convolution up to kernel truncation
+static void testEngineAgreement(WaveletTransform &transform)
+{
+    const std::vector<double> signal = testSignal(3000, 1);
+    const std::vector<double> scales = WaveletTransform::octaveGrid(1.0, 128.0, 4);
+    
+    for (int wavelet : {WaveletTransform::Morlet, WaveletTransform::MexicanHat, WaveletTransform::Daubechies}) {
+        WaveletTransform::Settings settings;
+        settings.waveletType = wavelet;
+        settings.supportTolerance = kTolerance;
+        settings.engine = WaveletTransform::EngineDirect;
+        const auto direct = transform.transform(signal, scales, settings);
+        settings.engine = WaveletTransform::EngineFFT;
+        const auto fft = transform.transform(signal, scales, settings);
+        
+        CHECK(direct->rows() == scales.size() && direct->columns() == signal.size(), "wavelet %d", wavelet);
+        CHECK(fft->rows() == direct->rows() && fft->columns() == direct->columns(), "wavelet %d", wavelet);
+        const double error = relativeError(*direct, *fft);
+        CHECK(error < kMaxError, "wavelet %d: FFT differs from direct by %g", wavelet, error);
+    }
+}
+
+static std::shared_ptr<CoefficientMatrix> computeRange(WaveletTransform &transform, const std::vector<double> &signal,
+                                                       size_t begin, size_t end, const std::vector<double> &scales,
+                                                       WaveletTransform::Job &job)
+{
+    job.engine = WaveletTransform::EngineFFT;
+    job.supportTolerance = kTolerance;
+    job.signal.assign(signal.begin() + begin, signal.begin() + end);
+    job.scales = scales;
+    job.signalStart = begin;
+    transform.compute(job);
+    return job.coefficients;
+}
+
+// A range moved within the previous one, with scales added and dropped,
+// must match a transform of the new range from scratch
+static void testIncremental(WaveletTransform &transform)
+{
+    const std::vector<double> signal = testSignal(20000, 2);
+    const std::vector<double> previousScales = WaveletTransform::octaveGrid(2.0, 64.0, 4);
+    std::vector<double> scales(previousScales.begin() + 2, previousScales.end());
+    scales.push_back(3.3);
+    scales.push_back(90.0);
+    
+    WaveletTransform::Job first;
+    const auto previous = computeRange(transform, signal, 0, 16000, previousScales, first);
+    
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+    for (const Range &range : {Range{0, 16000}, Range{0, 12000}, Range{3000, 16000}, Range{2500, 18000}}) {
+        WaveletTransform::Job incremental;
+        incremental.previous = previous;
+        incremental.previousScales = previousScales;
+        incremental.previousStart = 0;
+        const auto reused = computeRange(transform, signal, range.begin, range.end, scales, incremental);
+        
+        WaveletTransform::Job full;
+        const auto expected = computeRange(transform, signal, range.begin, range.end, scales, full);
+        
+        CHECK(incremental.reusedRows == previousScales.size() - 2, "range %zu-%zu reused %zu rows",
+              range.begin, range.end, incremental.reusedRows);
+        const double error = relativeError(*expected, *reused);
+        CHECK(error < kMaxError, "range %zu-%zu differs from a full recompute by %g", range.begin, range.end, error);
+    }
+}
+
+static bool sameMatrix(const CoefficientMatrix &a, const CoefficientMatrix &b)
+{
+    if (a.rows() != b.rows() || a.columns() != b.columns() || a.format() != b.format()) {
+        return false;
+    }
+    for (size_t row = 0; row < a.rows(); ++row) {
+        if (a.rowStep(row) != b.rowStep(row) ||
+            std::memcmp(a.rowData(row), b.rowData(row), a.rowColumns(row) * CoefficientMatrix::elementSize(a.format()))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every format, full resolution and decimated, over a size that leaves
+// partial chunks in both directions
+static void testArchiveRoundTrip(ThreadPool &pool)
+{
+    const size_t rows = 2 * CoefficientArchive::kChunkRows + 5;
+    const size_t columns = 2 * CoefficientArchive::kChunkColumns + 1234;
+    std::vector<double> scales(rows);
+    std::vector<size_t> steps(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        scales[row] = 1.5 * std::pow(1.1, static_cast<double>(row));
+        steps[row] = size_t(1) << std::min<size_t>(row / 8, 4);
+    }
+    const std::string path = temporaryPath("archive.mdscwz");
+    
+    std::mt19937 random(3);
+    std::normal_distribution<double> noise(0.0, 1e-3);
+    for (int format = CoefficientMatrix::ComplexDouble; format <= CoefficientMatrix::PowerFloat; ++format) {
+        for (bool decimated : {false, true}) {
+            CoefficientMatrix matrix = decimated
+                ? CoefficientMatrix(rows, columns, static_cast<CoefficientMatrix::Format>(format), steps)
+                : CoefficientMatrix(rows, columns, static_cast<CoefficientMatrix::Format>(format));
+            std::vector<std::complex<double>> values(columns);
+            for (size_t row = 0; row < rows; ++row) {
+                // Smooth rows with a noisy tail, so both codecs are used
+                for (size_t i = 0; i < matrix.rowColumns(row); ++i) {
+                    const double phase = 0.01 * static_cast<double>(i * matrix.rowStep(row)) / scales[row];
+                    values[i] = std::polar(1.0 + 0.5 * std::sin(phase), 4.0 * phase);
+                    if (row % 7 == 6) {
+                        values[i] += std::complex<double>(noise(random), noise(random));
+                    }
+                }
+                matrix.storeRow(row, values.data());
+            }
+            
+            CoefficientArchive::write(path, matrix, scales, 250.0, -1.5, &pool);
+            CoefficientArchive archive(path);
+            CHECK(archive.format() == format && archive.rows() == rows && archive.columns() == columns,
+                  "format %d decimated %d: header", format, decimated);
+            CHECK(archive.scales() == scales && archive.samplingRate() == 250.0 && archive.timeOrigin() == -1.5,
+                  "format %d decimated %d: metadata", format, decimated);
+            CHECK(sameMatrix(matrix, *archive.read(&pool)), "format %d decimated %d: parallel read",
+                  format, decimated);
+            CHECK(sameMatrix(matrix, *archive.read()), "format %d decimated %d: serial read", format, decimated);
+            
+            const auto magnitudes = archive.readMagnitudes(&pool);
+            bool sameMagnitudes = magnitudes->format() == CoefficientMatrix::MagnitudeFloat;
+            std::vector<float> expected(columns);
+            for (size_t row = 0; sameMagnitudes && row < rows; ++row) {
+                CoefficientMatrix::toMagnitudes(matrix.format(), matrix.rowData(row), matrix.rowColumns(row),
+                                                expected.data());
+                sameMagnitudes = magnitudes->rowStep(row) == matrix.rowStep(row) &&
+                                 !std::memcmp(magnitudes->rowData(row), expected.data(),
+                                              matrix.rowColumns(row) * sizeof(float));
+            }
+            CHECK(sameMagnitudes, "format %d decimated %d: magnitudes", format, decimated);
+        }
+    }
+    fs::remove(path);
+}
+
+// Random ranges, including ones inside a single cell and ones touching
+// either end, against a scan of the samples
+static void testEnvelope()
+{
+    std::mt19937 random(4);
+    std::normal_distribution<double> values(5.0, 3.0);
+    const size_t sizes[] = {1, 31, 32, 33, 1000, 65537};
+    for (size_t size : sizes) {
+        std::vector<double> samples(size);
+        for (double &sample : samples) {
+            sample = values(random);
+        }
+        auto floats = std::make_shared<std::vector<float>>(samples.begin(), samples.end());
+        const SignalColumn columns[] = {
+            SignalColumn(samples),
+            SignalColumn(floats, floats->data(), size, SignalColumn::Float32),
+        };
+        
+        for (const SignalColumn &column : columns) {
+            SignalEnvelope envelope;
+            envelope.build(column);
+            for (int query = 0; query < 2000; ++query) {
+                size_t begin = random() % size;
+                size_t end = random() % size;
+                if (begin > end) {
+                    std::swap(begin, end);
+                }
+                end += 1;
+                if (query == 0) {
+                    begin = 0;
+                    end = size;
+                }
+                
+                double minimum = column[begin];
+                double maximum = column[begin];
+                double sum = 0.0;
+                for (size_t i = begin; i < end; ++i) {
+                    minimum = std::min(minimum, column[i]);
+                    maximum = std::max(maximum, column[i]);
+                    sum += column[i];
+                }
+                const auto extrema = envelope.minMax(begin, end);
+                CHECK(extrema.first == minimum && extrema.second == maximum, "size %zu, [%zu, %zu): min/max",
+                      size, begin, end);
+                CHECK(std::abs(envelope.sum(begin, end) - sum) <= 1e-9 * (end - begin) * 8.0,
+                      "size %zu, [%zu, %zu): sum %g, expected %g", size, begin, end, envelope.sum(begin, end), sum);
+            }
+        }
+    }
+}
+
+static CSVReader::Data readCSV(const std::string &name, const std::string &text, ThreadPool &pool)
+{
+    const std::string path = temporaryPath(name);
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << text;
+    }
+    CSVReader::Data data = CSVReader::read(path, pool);
+    fs::remove(path);
+    return data;
+}
+
+static void testCSV(ThreadPool &pool)
+{
+    // ';' with a header, blanks, a '+' sign and a row of the wrong width
+    CSVReader::Data data = readCSV("semicolon.csv", "time;a;b\n0;1.5;-2\n0.5; +3 ;4e1\r\n1;5\n1.5;6;7\n", pool);
+    CHECK(data.time == std::vector<double>({0.0, 0.5, 1.5}), "';': time");
+    CHECK(data.channels.size() == 2, "';': %zu channels", data.channels.size());
+    if (data.channels.size() == 2) {
+        CHECK(data.channels[0] == std::vector<double>({1.5, 3.0, 6.0}), "';': first channel");
+        CHECK(data.channels[1] == std::vector<double>({-2.0, 40.0, 7.0}), "';': second channel");
+    }
+    
+    data = readCSV("comma.csv", "# recording\n0,10\n1,20\n2,30", pool);
+    CHECK(data.time == std::vector<double>({0.0, 1.0, 2.0}), "',': time");
+    CHECK(data.channels.size() == 1 && data.channels[0] == std::vector<double>({10.0, 20.0, 30.0}),
+          "',': channel");
+    
+    data = readCSV("single.csv", "value\n1\n-2\n3.25\n", pool);
+    CHECK(data.time.empty(), "single column: time should be left to the caller");
+    CHECK(data.channels.size() == 1 && data.channels[0] == std::vector<double>({1.0, -2.0, 3.25}),
+          "single column: channel");
+    
+    // Large enough to be split into chunks, which must keep the row order
+    std::string text = "t;x\n";
+    const size_t lines = 300000;
+    for (size_t i = 0; i < lines; ++i) {
+        text += std::to_string(i) + ";" + std::to_string(i % 977) + "\n";
+    }
+    data = readCSV("chunked.csv", text, pool);
+    bool ordered = data.time.size() == lines && data.channels.size() == 1 && data.channels[0].size() == lines;
+    for (size_t i = 0; ordered && i < lines; ++i) {
+        ordered = data.time[i] == static_cast<double>(i) && data.channels[0][i] == static_cast<double>(i % 977);
+    }
+    CHECK(ordered, "chunked file: rows out of order or missing");
+    
+    double value = 0.0;
+    const char number[] = " +2.5 ";
+    CHECK(CSVReader::parseNumber(number, number + sizeof(number) - 1, value) && value == 2.5, "parseNumber");
+    const char word[] = "x1";
+    CHECK(!CSVReader::parseNumber(word, word + 2, value), "parseNumber accepted a word");
+}
+
+int main(int argc, char *argv[])
+{
+    WaveletTransform transform(4);
+    ThreadPool &pool = transform.threadPool();
+    
+    struct Case {
+        const char *name;
+        std::function<void()> run;
+    };
+    const std::vector<Case> cases = {
+        {"engines", [&]() { testEngineAgreement(transform); }},
+        {"incremental", [&]() { testIncremental(transform); }},
+        {"archive", [&]() { testArchiveRoundTrip(pool); }},
+        {"envelope", [&]() { testEnvelope(); }},
+        {"csv", [&]() { testCSV(pool); }},
+    };
+    
+    int ran = 0;
+    for (const Case &test : cases) {
+        const bool selected = argc < 2 || std::any_of(argv + 1, argv + argc, [&](const char *name) {
+            return std::strcmp(name, test.name) == 0;
+        });
+        if (!selected) {
+            continue;
+        }
+        const int failuresBefore = s_failures;
+        try {
+            test.run();
+        } catch (const std::exception &e) {
+            std::fprintf(stderr, "%s: %s\n", test.name, e.what());
+            ++s_failures;
+        }
+        std::fprintf(stderr, "%-12s %s\n", test.name, s_failures == failuresBefore ? "ok" : "FAILED");
+        ++ran;
+    }
+    if (ran == 0) {
+        std::fprintf(stderr, "mdsv2_tests: no such case\n");
+        return 1;
+    }
+    return s_failures == 0 ? 0 : 1;
+}